@@ -0,0 +1,592 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "address.h"
+#include "base58.h"
+#include "block_view.h"
+#include "byte_stream.h"
+#include "file_merkle.h"
+#include "flat_tree.h"
+#include "hash_utils.h"
+#include "hex.h"
+#include "incremental_tree.h"
+#include "key.h"
+#include "merkle_accumulator.h"
+#include "merkle_proof.h"
+#include "merkle_tree.h"
+#include "pub_key.h"
+#include "sha256.h"
+#include "sparse_tree.h"
+#include "thread_pool.h"
+#include "transaction.h"
+
+/// Number of heap allocations since program start.
+static std::atomic<uint64_t> g_num_allocs(0);
+
+void *operator new(size_t size) {
+  g_num_allocs.fetch_add(1, std::memory_order_relaxed);
+  void *p = std::malloc(size ? size : 1);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete[](void *p) noexcept { std::free(p); }
+
+namespace {
+
+/// Minimal time spent in each benchmark.
+const double MIN_SECONDS = 0.5;
+
+/// Extra values reported with a benchmark, name and value.
+typedef std::vector<std::pair<std::string, double>> Counters;
+
+/// Benchmark results, printed as JSON at exit.
+struct Result {
+  std::string name;
+  uint64_t iterations;
+  double ns_per_op;
+  double bytes_per_sec;
+  double allocs_per_op;
+  Counters counters;
+};
+std::vector<Result> g_results;
+
+/// Only run benchmarks whose name contains this string.
+std::string g_filter;
+
+/// Keep results alive, so the compiler cannot drop the benchmarked code.
+volatile uint8_t g_sink;
+
+/// True if the benchmark is selected by the filter.
+bool Selected(const std::string &name) {
+  return name.find(g_filter) != std::string::npos;
+}
+
+void Consume(const uint8_t *p, size_t size) {
+  if (size > 0) g_sink = p[0] ^ p[size - 1];
+}
+
+void Consume(const std::vector<uint8_t> &data) {
+  Consume(data.data(), data.size());
+}
+
+/**
+ * Run a benchmark.
+ *
+ * Iterations double until the run takes MIN_SECONDS, the last run is
+ * reported.
+ *
+ * @param name Benchmark name.
+ * @param bytes_per_op Bytes processed by each call, 0 if not meaningful.
+ * @param op Operation to measure, the first call is not measured and may
+ *     build the data of the benchmark.
+ * @param counters Extra values to report.
+ */
+void Run(const std::string &name, size_t bytes_per_op,
+         const std::function<void()> &op,
+         const Counters &counters = Counters()) {
+  if (!Selected(name)) return;
+  op();  // Warm up.
+  uint64_t iterations = 1;
+  while (true) {
+    uint64_t allocs = g_num_allocs.load();
+    auto begin = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; ++i) op();
+    auto end = std::chrono::steady_clock::now();
+    allocs = g_num_allocs.load() - allocs;
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    if (seconds >= MIN_SECONDS || iterations >= (1ull << 40)) {
+      Result result;
+      result.name = name;
+      result.iterations = iterations;
+      result.ns_per_op = seconds * 1e9 / iterations;
+      result.bytes_per_sec =
+          bytes_per_op > 0 ? bytes_per_op * iterations / seconds : 0;
+      result.allocs_per_op = static_cast<double>(allocs) / iterations;
+      result.counters = counters;
+      g_results.push_back(result);
+      fprintf(stderr, "%-40s %14.1f ns/op\n", name.c_str(), result.ns_per_op);
+      return;
+    }
+    iterations *= 2;
+  }
+}
+
+/// Deterministic data, so every run hashes the same bytes.
+std::vector<uint8_t> MakeData(size_t size, uint32_t seed) {
+  std::vector<uint8_t> data(size);
+  uint32_t x = seed * 2654435761u + 1;
+  for (uint8_t &b : data) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    b = x;
+  }
+  return data;
+}
+
+struct Trunk {
+  std::vector<uint8_t> data;
+
+  coin::data::Buffer CalcHash() const {
+    coin::Hash256Builder hash_builder;
+    hash_builder << coin::data::MakeValue(data);
+    return hash_builder.FinalValue();
+  }
+};
+
+std::vector<Trunk> MakeTrunks(size_t count) {
+  std::vector<Trunk> trunks(count);
+  for (size_t i = 0; i < count; ++i) trunks[i].data = MakeData(64, i);
+  return trunks;
+}
+
+coin::Transaction MakeTransaction(int num_in, int num_out) {
+  coin::Transaction tx;
+  coin::data::Buffer pub_key;
+  pub_key.value = MakeData(33, 1);
+  tx.set_pub_key(pub_key);
+  for (int i = 0; i < num_in; ++i) {
+    coin::TxIn in;
+    in.tx_hash = coin::bn::HashNum(MakeData(32, i).data());
+    in.out_index = i;
+    auto signature = MakeData(72, i + 1000);
+    in.signature.CopyFrom(signature.data(), signature.size());
+    tx.add_tx_in(in);
+  }
+  for (int i = 0; i < num_out; ++i) {
+    coin::TxOut out;
+    out.address = "12iPmmNQQ9oqnjT5Nj7eg7bPmQtLXUQUmq";
+    out.amount = 1000 + i;
+    tx.add_tx_out(out);
+  }
+  return tx;
+}
+
+void BenchHash() {
+  for (size_t size : {32, 64, 1024, 1024 * 1024}) {
+    auto data = MakeData(size, size);
+    Run("Hash256/" + std::to_string(size), size, [&data]() {
+      Consume(coin::Hash256Builder::CalculateHash(data));
+    });
+  }
+  for (size_t size : {32, 1024}) {
+    auto data = MakeData(size, size);
+    Run("Hash160/" + std::to_string(size), size, [&data]() {
+      Consume(coin::Hash160Builder::CalculateHash(data));
+    });
+  }
+
+  auto in = MakeData(64 * 1024, 64);
+  std::vector<uint8_t> out(32 * 1024);
+  Run("Hash64To32/1024", in.size(), [&in, &out]() {
+    coin::Hash64To32(in.data(), out.data(), 1024);
+    Consume(out);
+  });
+
+  std::vector<std::vector<uint8_t>> messages;
+  for (int i = 0; i < 1024; ++i) messages.push_back(MakeData(100, i));
+  coin::Hash256Batch batch;
+  Run("Hash256Batch/1024x100", 1024 * 100, [&messages, &batch]() {
+    batch.Clear();
+    for (const auto &message : messages) batch.Add(message);
+    batch.Calculate();
+    Consume(batch.get_md(0), batch.get_md_size());
+  });
+}
+
+void BenchHashBuilder() {
+  coin::TxOut out;
+  out.address = "12iPmmNQQ9oqnjT5Nj7eg7bPmQtLXUQUmq";
+  out.amount = 1000;
+  Run("HashBuilder/TxOut", 0, [&out]() { Consume(out.CalcHash().value); });
+
+  coin::TxIn in;
+  in.tx_hash = coin::bn::HashNum(MakeData(32, 1).data());
+  in.out_index = 1;
+  auto signature = MakeData(72, 2);
+  in.signature.CopyFrom(signature.data(), signature.size());
+  Run("HashBuilder/TxIn", 0, [&in]() { Consume(in.CalcHash().value); });
+}
+
+void BenchMerkleTree() {
+  for (size_t leaves : {16, 1024, 16384}) {
+    std::vector<Trunk> trunks = MakeTrunks(leaves);
+    Run("MakeMerkleTree/" + std::to_string(leaves), leaves * 64,
+        [&trunks]() {
+          Consume(coin::mt::MakeMerkleTree(trunks)->get_hash().value);
+        });
+    coin::mt::FlatTree tree;
+    Run("FlatTree/" + std::to_string(leaves), leaves * 64,
+        [&trunks, &tree]() {
+          tree.BuildFrom(trunks);
+          Consume(tree.GetRoot(), coin::mt::HASH_SIZE);
+        });
+  }
+
+  auto leaves = MakeData(16384 * coin::mt::HASH_SIZE, 13);
+  coin::mt::IncrementalTree incremental;
+  incremental.Assign(leaves.data(), 16384);
+  size_t index = 0;
+  Run("IncrementalTree::Replace/16384", 0, [&]() {
+    index = (index + 7919) % 16384;
+    incremental.Replace(index, leaves.data() + index * coin::mt::HASH_SIZE);
+    Consume(incremental.GetRoot(), coin::mt::HASH_SIZE);
+  });
+  Run("IncrementalTree::Append+RemoveLast/16384", 0, [&]() {
+    incremental.Append(leaves.data());
+    incremental.RemoveLast();
+    Consume(incremental.GetRoot(), coin::mt::HASH_SIZE);
+  });
+
+  Run("RootAccumulator/16384", 0, [&leaves]() {
+    coin::mt::RootAccumulator accumulator;
+    for (size_t i = 0; i < 16384; ++i) {
+      accumulator.Push(leaves.data() + i * coin::mt::HASH_SIZE);
+    }
+    uint8_t root[coin::mt::HASH_SIZE];
+    accumulator.Root(root);
+    Consume(root, sizeof(root));
+  });
+
+  coin::mt::Proof proof;
+  Run("MakeProof/16384", 0, [&]() {
+    index = (index + 7919) % 16384;
+    coin::mt::MakeProof(incremental, index, proof);
+    g_sink = proof.num_siblings;
+  });
+  coin::mt::MakeProof(incremental, 1234, proof);
+  Run("VerifyProof/16384", 0, [&]() {
+    g_sink = coin::mt::VerifyProof(incremental.GetLeafHash(1234), proof,
+                                   incremental.GetRoot());
+  });
+
+  // A wallet asking for 500 transactions of a 16384 transactions block.
+  if (Selected("VerifyMultiProof/500of16384") ||
+      Selected("VerifyProof/500of16384")) {
+    std::vector<uint64_t> wanted;
+    for (uint64_t i = 0; i < 500; ++i) wanted.push_back(i * 16384 / 500);
+    coin::mt::MultiProof multi_proof;
+    coin::mt::MakeMultiProof(incremental, wanted, multi_proof);
+    std::vector<uint8_t> wanted_hashes;
+    std::vector<coin::mt::Proof> proofs(wanted.size());
+    size_t single_size = 0;
+    for (size_t i = 0; i < wanted.size(); ++i) {
+      const uint8_t *hash = incremental.GetLeafHash(wanted[i]);
+      wanted_hashes.insert(wanted_hashes.end(), hash,
+                           hash + coin::mt::HASH_SIZE);
+      coin::mt::MakeProof(incremental, wanted[i], proofs[i]);
+      single_size += proofs[i].GetSerializedSize();
+    }
+    Run("VerifyMultiProof/500of16384", 0,
+        [&]() {
+          g_sink = coin::mt::VerifyMultiProof(
+              wanted_hashes.data(), multi_proof, incremental.GetRoot());
+        },
+        {{"proof_bytes", multi_proof.GetSerializedSize()}});
+    Run("VerifyProof/500of16384", 0,
+        [&]() {
+          bool valid = true;
+          for (size_t i = 0; i < wanted.size(); ++i) {
+            valid &= coin::mt::VerifyProof(
+                wanted_hashes.data() + i * coin::mt::HASH_SIZE, proofs[i],
+                incremental.GetRoot());
+          }
+          g_sink = valid;
+        },
+        {{"proof_bytes", single_size}});
+  }
+
+  // Built by the first benchmark run, shared by the others.
+  std::vector<Trunk> trunks;
+  size_t max_threads = std::thread::hardware_concurrency();
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    coin::ThreadPool pool(threads);
+    Run("MakeMerkleRoot/65536/threads:" + std::to_string(threads), 65536 * 64,
+        [&trunks, &pool]() {
+          if (trunks.empty()) trunks = MakeTrunks(65536);
+          Consume(coin::mt::MakeMerkleRoot(trunks, pool).value);
+        });
+  }
+}
+
+void BenchHashChunks() {
+  const size_t size = 256 * 1024 * 1024;
+  // Built by the first benchmark run, shared by the others.
+  std::vector<uint8_t> data;
+  size_t max_threads = std::thread::hardware_concurrency();
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    coin::ThreadPool pool(threads);
+    Run("HashChunks/256MB/threads:" + std::to_string(threads), size,
+        [&data, &pool]() {
+          if (data.empty()) data = MakeData(size, 9);
+          Consume(coin::mt::HashChunks(data.data(), data.size(),
+                                       coin::mt::DEFAULT_CHUNK_SIZE, pool)
+                      .value);
+        });
+  }
+}
+
+void BenchSparseTree() {
+  std::vector<coin::mt::SparseTree::Update> updates(11000);
+  for (size_t i = 0; i < updates.size(); ++i) {
+    updates[i].first = coin::bn::HashNum(MakeData(32, i).data());
+    updates[i].second.value = MakeData(32, i + 100000);
+  }
+  coin::mt::SparseTree tree;
+  tree.Apply(std::vector<coin::mt::SparseTree::Update>(
+      updates.begin(), updates.begin() + 10000));
+  std::vector<coin::mt::SparseTree::Update> block(updates.begin() + 10000,
+                                                  updates.end());
+  Run("SparseTree::Apply/1000", 0, [&tree, &block]() {
+    tree.Apply(block);
+    Consume(tree.GetRoot(), coin::mt::HASH_SIZE);
+  });
+  coin::mt::SparseProof proof;
+  Run("SparseTree::MakeProof", 0, [&tree, &updates, &proof]() {
+    tree.MakeProof(updates[7].first, proof);
+    g_sink = proof.num_siblings();
+  });
+  tree.MakeProof(updates[7].first, proof);
+  Run("VerifySparseProof", 0, [&tree, &updates, &proof]() {
+    g_sink = coin::mt::VerifySparseProof(updates[7].first,
+                                         updates[7].second.value.data(), proof,
+                                         tree.GetRoot());
+  });
+}
+
+void BenchBase58() {
+  auto data = MakeData(25, 58);
+  data[0] = 0;
+  std::string str = base58::EncodeBase58(data);
+  Run("EncodeBase58/25", data.size(), [&data]() {
+    std::string str = base58::EncodeBase58(data);
+    Consume(reinterpret_cast<const uint8_t *>(str.data()), str.size());
+  });
+  Run("DecodeBase58/25", data.size(), [&str]() {
+    std::vector<unsigned char> out;
+    base58::DecodeBase58(str, out);
+    Consume(out);
+  });
+}
+
+void BenchHex() {
+  for (size_t size : {32, 4096}) {
+    auto data = MakeData(size, 16);
+    std::string str(size * 2, '\0');
+    Run("HexEncode/" + std::to_string(size), size, [&data, &str]() {
+      coin::hex::Encode(data.data(), data.size(), &str[0]);
+      Consume(reinterpret_cast<const uint8_t *>(str.data()), str.size());
+    });
+    std::vector<uint8_t> out(size);
+    Run("HexDecode/" + std::to_string(size), size, [&str, &out]() {
+      g_sink = coin::hex::Decode(str.data(), out.size(), out.data());
+      Consume(out);
+    });
+  }
+  coin::data::Buffer hash;
+  hash.value = MakeData(32, 17);
+  Run("HashToStr/32", 32, [&hash]() {
+    std::string str = coin::HashToStr(hash, 32);
+    Consume(reinterpret_cast<const uint8_t *>(str.data()), str.size());
+  });
+}
+
+void BenchKey() {
+  ecdsa::Key key(MakeData(32, 7));
+  auto pub_key_data = key.get_pub_key_data();
+  Run("Address::FromPublicKey", 0, [&pub_key_data]() {
+    std::string str = coin::Address::FromPublicKey(pub_key_data).ToString();
+    Consume(reinterpret_cast<const uint8_t *>(str.data()), str.size());
+  });
+
+  std::vector<std::vector<uint8_t>> pub_keys;
+  for (int i = 0; i < 1024; ++i) {
+    ecdsa::Key batch_key(MakeData(32, i + 100));
+    pub_keys.push_back(batch_key.get_pub_key_data());
+  }
+  coin::AddressBatch batch;
+  Run("AddressBatch/1024", 0, [&pub_keys, &batch]() {
+    batch.FromPublicKeys(pub_keys);
+    Consume(reinterpret_cast<const uint8_t *>(batch.get_data(0)),
+            batch.get_size(0));
+  });
+
+  auto hash = MakeData(32, 8);
+  Run("Key::Sign", 0, [&key, &hash]() { Consume(key.Sign(hash)); });
+
+  auto sig = key.Sign(hash);
+  auto pub_key = key.CreatePubKey();
+  Run("PubKey::Verify", 0, [&pub_key, &hash, &sig]() {
+    g_sink = pub_key.Verify(hash, sig);
+  });
+}
+
+void BenchTransaction() {
+  auto tx = MakeTransaction(4, 4);
+  std::stringstream ss;
+  tx.Serialize(ss);
+  std::string data = ss.str();
+  Run("Transaction::Serialize/4x4", data.size(), [&tx]() {
+    std::stringstream ss;
+    tx.Serialize(ss);
+    g_sink = ss.tellp();
+  });
+  Run("Transaction::Unserialize/4x4", data.size(), [&data]() {
+    std::stringstream ss(data);
+    coin::Transaction tx;
+    tx.Unserialize(ss);
+    g_sink = tx.get_time();
+  });
+  Run("Transaction::Serialize/ByteWriter/4x4", data.size(), [&tx]() {
+    coin::data::ByteWriter writer;
+    tx.Serialize(writer);
+    g_sink = writer.get_size();
+  });
+  Run("Transaction::Serialize/Reserved/4x4", data.size(), [&tx]() {
+    coin::data::ByteWriter writer;
+    writer.Reserve(tx.GetSerializedSize());
+    tx.Serialize(writer);
+    g_sink = writer.get_size();
+  });
+  Run("Transaction::GetSerializedSize/4x4", 0,
+      [&tx]() { g_sink = tx.GetSerializedSize(); });
+  Run("Transaction::Unserialize/ByteReader/4x4", data.size(), [&data]() {
+    coin::data::ByteReader reader(
+        reinterpret_cast<const uint8_t *>(data.data()), data.size());
+    coin::Transaction tx;
+    tx.Unserialize(reader);
+    g_sink = tx.get_time();
+  });
+  Run("Transaction::CalcHash/4x4", 0,
+      [&tx]() { Consume(tx.CalcHash().value); });
+}
+
+void BenchContainers() {
+  const size_t n = 1 << 18;
+  std::vector<uint32_t> ints(n);
+  for (size_t i = 0; i < n; ++i) {
+    ints[i] = static_cast<uint32_t>(i * 2654435761u);
+  }
+  std::vector<coin::bn::HashNum> hashes(n / 8);
+  coin::data::ByteWriter writer;
+  Run("Value<vector<uint32_t>>::Write/256K", n * sizeof(uint32_t),
+      [&ints, &writer]() {
+        writer.Clear();
+        coin::data::WriteVector(writer, ints);
+        g_sink = writer.get_size();
+      });
+  writer.Clear();
+  coin::data::WriteVector(writer, ints);
+  Run("Value<vector<uint32_t>>::Read/256K", n * sizeof(uint32_t),
+      [&writer, &ints]() {
+        coin::data::ByteReader reader(writer.get_data(), writer.get_size());
+        coin::data::ReadVector(reader, ints);
+        g_sink = ints.size();
+      });
+  Run("Value<vector<HashNum>>::Write/32K", hashes.size() * 32,
+      [&hashes, &writer]() {
+        writer.Clear();
+        coin::data::WriteVector(writer, hashes);
+        g_sink = writer.get_size();
+      });
+}
+
+void BenchBlock() {
+  coin::blk::Block block;
+  for (int i = 0; i < 100; ++i) {
+    block.get_trans().push_back(MakeTransaction(4, 4));
+  }
+  coin::data::ByteWriter writer;
+  block.Serialize(writer);
+  std::vector<uint8_t> data = writer.Release();
+  Run("Block::Unserialize/100tx", data.size(), [&data]() {
+    coin::data::ByteReader reader(data);
+    coin::blk::Block block;
+    block.Unserialize(reader);
+    g_sink = block.get_trans().size();
+  });
+  coin::data::Arena block_arena;
+  Run("Block::Unserialize/Arena/100tx", data.size(), [&data, &block_arena]() {
+    {
+      coin::data::ByteReader reader(data);
+      coin::blk::Block block(&block_arena);
+      block.Unserialize(reader);
+      g_sink = block.get_trans().size();
+    }
+    block_arena.Reset();
+  });
+  Run("BlockView::Parse/100tx", data.size(), [&data]() {
+    coin::blk::BlockView view;
+    view.Parse(data.data(), data.size());
+    g_sink = view.transaction_count();
+  });
+  coin::blk::BlockView view;
+  view.Parse(data.data(), data.size());
+  Run("BlockView::IndexTransactions/100tx", data.size(), [&view]() {
+    g_sink = view.IndexTransactions().size();
+  });
+  coin::data::Arena arena;
+  Run("BlockView::IndexTransactions/Arena/100tx", data.size(),
+      [&view, &arena]() {
+        g_sink = view.IndexTransactions(&arena).size();
+        arena.Reset();
+      });
+}
+
+void PrintJson() {
+  printf("{\n  \"sha256\": \"%s\",\n  \"benchmarks\": [",
+         coin::sha256::GetImplementation());
+  for (size_t i = 0; i < g_results.size(); ++i) {
+    const Result &r = g_results[i];
+    printf("%s\n    {\"name\": \"%s\", \"iterations\": %llu, "
+           "\"ns_per_op\": %.2f, \"bytes_per_sec\": %.0f, "
+           "\"allocs_per_op\": %.2f",
+           i ? "," : "", r.name.c_str(),
+           static_cast<unsigned long long>(r.iterations), r.ns_per_op,
+           r.bytes_per_sec, r.allocs_per_op);
+    for (const auto &counter : r.counters) {
+      printf(", \"%s\": %.0f", counter.first.c_str(), counter.second);
+    }
+    printf("}");
+  }
+  printf("\n  ]\n}\n");
+}
+
+}  // namespace
+
+/**
+ * Run benchmarks and print results as JSON to stdout.
+ *
+ * Usage: cryptocoin_bench [filter]
+ */
+int main(int argc, char *argv[]) {
+  if (argc > 1) g_filter = argv[1];
+  BenchHash();
+  BenchHashBuilder();
+  BenchMerkleTree();
+  BenchHashChunks();
+  BenchSparseTree();
+  BenchBase58();
+  BenchHex();
+  BenchKey();
+  BenchTransaction();
+  BenchContainers();
+  BenchBlock();
+  PrintJson();
+  return 0;
+}
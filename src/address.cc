@@ -10,36 +10,113 @@
 
 namespace coin {
 
-Address Address::FromPublicKey(const std::vector<uint8_t> &pub_key) {
+/// Size of address data in front of checksum.
+static const size_t CHECKSUM_OFFSET = 1 + RIPEMD160_DIGEST_LENGTH;
+
+/// Size of checksum.
+static const size_t CHECKSUM_SIZE = 4;
+
+/// Largest address string.
+static const size_t MAX_ADDRESS_SIZE =
+    base58::GetMaxEncodedSize(Address::PAYLOAD_SIZE);
+
+/// Add 0x00 on front of RIPEMD160 hash value.
+static void MakePayloadFromSHA256(const uint8_t *md, uint8_t *payload) {
+  Hash160 algo;
+  algo.Calculate(md, sha256::OUTPUT_SIZE);
+  algo.Final();
+  payload[0] = 0x00;
+  memcpy(payload + 1, algo.get_md(), algo.get_md_size());
+}
+
+void Address::MakePayload(const uint8_t *pub_key, size_t size,
+                          uint8_t *payload) {
   // 1. SHA256
-  auto result = Hash256Builder::CalculateHash(pub_key.data(), pub_key.size());
+  Hash256 sha;
+  sha.Calculate(pub_key, size);
+  sha.Final();
 
   // 2. RIPEMD160
-  result = Hash256Builder::CalculateHash(result.data(), result.size());
-
   // 3. Add 0x00 on front
-  std::vector<uint8_t> temp;
-  temp.resize(result.size() + 1);
-  temp[0] = 0x00;
-  std::memcpy(temp.data() + 1, result.data(), result.size());
-  result = temp;
+  MakePayloadFromSHA256(sha.get_md(), payload);
 
   // 4. SHA256 twice
-  result = Hash256Builder::CalculateHash(result.data(), result.size());
-  result = Hash256Builder::CalculateHash(result.data(), result.size());
+  Hash256 sha_first;
+  sha_first.Calculate(payload, CHECKSUM_OFFSET);
+  sha_first.Final();
+  Hash256 sha_second;
+  sha_second.Calculate(sha_first.get_md(), sha_first.get_md_size());
+  sha_second.Final();
+
+  // 5. Take first 4 bytes as checksum
+  memcpy(payload + CHECKSUM_OFFSET, sha_second.get_md(), CHECKSUM_SIZE);
+}
 
-  // 5. Take first 4 bytes and add to temp
-  std::vector<uint8_t> long_result;
-  long_result.resize(temp.size() + 4);
-  memcpy(long_result.data(), temp.data(), temp.size());
-  memcpy(long_result.data() + temp.size(), result.data(), 4);
+Address Address::FromPublicKey(const std::vector<uint8_t> &pub_key) {
+  return FromPublicKey(pub_key.data(), pub_key.size());
+}
+
+Address Address::FromPublicKey(const uint8_t *pub_key, size_t size) {
+  uint8_t payload[PAYLOAD_SIZE];
+  MakePayload(pub_key, size, payload);
 
   // 6. Base58
+  char str[MAX_ADDRESS_SIZE];
+  size_t str_size =
+      base58::EncodeBase58(payload, payload + PAYLOAD_SIZE, str, sizeof(str));
   Address addr;
-  addr.addr_str_ = base58::EncodeBase58(long_result);
+  addr.addr_str_.assign(str, str_size);
 
   // Returns address object
   return addr;
 }
 
+void AddressBatch::FromPublicKeys(
+    const std::vector<std::vector<uint8_t>> &pub_keys) {
+  size_t n = pub_keys.size();
+  const size_t MD_SIZE = sha256::OUTPUT_SIZE;
+  payloads_.resize(n * Address::PAYLOAD_SIZE);
+  mds_.resize(n * MD_SIZE * 2);
+  data_.resize(n);
+  sizes_.resize(n);
+
+  // 1. SHA256 of every public key.
+  for (size_t i = 0; i < n; ++i) {
+    data_[i] = pub_keys[i].data();
+    sizes_[i] = pub_keys[i].size();
+  }
+  sha256::HashMany(data_.data(), sizes_.data(), n, mds_.data());
+
+  // 2. RIPEMD160 and 3. add 0x00 on front.
+  for (size_t i = 0; i < n; ++i) {
+    uint8_t *payload = payloads_.data() + i * Address::PAYLOAD_SIZE;
+    MakePayloadFromSHA256(mds_.data() + i * MD_SIZE, payload);
+    data_[i] = payload;
+    sizes_[i] = CHECKSUM_OFFSET;
+  }
+
+  // 4. SHA256 twice, second pass writes to the upper half of mds_.
+  sha256::HashMany(data_.data(), sizes_.data(), n, mds_.data());
+  for (size_t i = 0; i < n; ++i) {
+    data_[i] = mds_.data() + i * MD_SIZE;
+    sizes_[i] = MD_SIZE;
+  }
+  uint8_t *checksums = mds_.data() + n * MD_SIZE;
+  sha256::HashMany(data_.data(), sizes_.data(), n, checksums);
+
+  // 5. Take first 4 bytes as checksum and 6. base58.
+  arena_.resize(n * MAX_ADDRESS_SIZE);
+  offsets_.resize(n + 1);
+  offsets_[0] = 0;
+  for (size_t i = 0; i < n; ++i) {
+    uint8_t *payload = payloads_.data() + i * Address::PAYLOAD_SIZE;
+    memcpy(payload + CHECKSUM_OFFSET, checksums + i * MD_SIZE, CHECKSUM_SIZE);
+    offsets_[i + 1] =
+        offsets_[i] + base58::EncodeBase58(payload,
+                                           payload + Address::PAYLOAD_SIZE,
+                                           arena_.data() + offsets_[i],
+                                           MAX_ADDRESS_SIZE);
+  }
+}
+
 }  // namespace coin
@@ -11,6 +11,9 @@ namespace coin {
 
 class Address {
  public:
+  /// Size of address data: version byte, RIPEMD160 hash and checksum.
+  static const size_t PAYLOAD_SIZE = 25;
+
   /**
    * Convert a public key to address.
    *
@@ -20,6 +23,29 @@ class Address {
    */
   static Address FromPublicKey(const std::vector<uint8_t> &pub_key);
 
+  /**
+   * Convert a public key to address.
+   *
+   * Every step runs on fixed-size stack buffers, only the address string is
+   * allocated.
+   *
+   * @param pub_key Public key data.
+   * @param size Size of public key data.
+   *
+   * @return New generated address object.
+   */
+  static Address FromPublicKey(const uint8_t *pub_key, size_t size);
+
+  /**
+   * Make address data of a public key.
+   *
+   * @param pub_key Public key data.
+   * @param size Size of public key data.
+   * @param payload Output, PAYLOAD_SIZE bytes to be base58 encoded.
+   */
+  static void MakePayload(const uint8_t *pub_key, size_t size,
+                          uint8_t *payload);
+
   /// Convert address object to string
   std::string ToString() const { return addr_str_; }
 
@@ -30,6 +56,50 @@ class Address {
   std::string addr_str_;
 };
 
+/**
+ * Derive addresses of many public keys.
+ *
+ * SHA-256 passes run as multi-lane batches and addresses are written back to
+ * back into one character buffer. Buffers are kept between calls, so
+ * deriving more batches with the same object does not allocate once the
+ * buffers are large enough.
+ */
+class AddressBatch {
+ public:
+  /**
+   * Derive addresses, results of the previous call are replaced.
+   *
+   * @param pub_keys Public keys.
+   */
+  void FromPublicKeys(const std::vector<std::vector<uint8_t>> &pub_keys);
+
+  /// Number of addresses.
+  size_t size() const { return offsets_.empty() ? 0 : offsets_.size() - 1; }
+
+  /// Characters of address `index`, not null terminated.
+  const char *get_data(size_t index) const {
+    return arena_.data() + offsets_[index];
+  }
+
+  /// Number of characters of address `index`.
+  size_t get_size(size_t index) const {
+    return offsets_[index + 1] - offsets_[index];
+  }
+
+  /// Address `index` as string.
+  std::string ToString(size_t index) const {
+    return std::string(get_data(index), get_size(index));
+  }
+
+ private:
+  std::vector<char> arena_;
+  std::vector<size_t> offsets_;
+  std::vector<uint8_t> payloads_;
+  std::vector<uint8_t> mds_;
+  std::vector<const uint8_t *> data_;
+  std::vector<size_t> sizes_;
+};
+
 }  // namespace coin
 
 #endif
@@ -0,0 +1,51 @@
+#include "arena.h"
+
+#include <cstdlib>
+
+#include <algorithm>
+
+namespace coin {
+namespace data {
+
+const size_t Arena::DEFAULT_SLAB_SIZE;
+
+Arena::~Arena() {
+  while (slabs_) {
+    Slab *next = slabs_->next;
+    free(slabs_);
+    slabs_ = next;
+  }
+}
+
+void Arena::Reset() {
+  if (!slabs_) return;
+  Slab *slab = slabs_->next;
+  while (slab) {
+    Slab *next = slab->next;
+    free(slab);
+    slab = next;
+  }
+  slabs_->next = nullptr;
+  memory_size_ = slabs_->size;
+  pos_ = reinterpret_cast<uint8_t *>(slabs_ + 1);
+  end_ = reinterpret_cast<uint8_t *>(slabs_) + slabs_->size;
+  used_ = 0;
+}
+
+void *Arena::AllocateSlow(size_t size, size_t align) {
+  // Slabs grow with the arena, so large blocks need few of them.
+  size_t slab_size = std::max(slab_size_, memory_size_);
+  slab_size = std::max(slab_size, sizeof(Slab) + size + align);
+  Slab *slab = static_cast<Slab *>(malloc(slab_size));
+  if (!slab) throw std::bad_alloc();
+  slab->next = slabs_;
+  slab->size = slab_size;
+  slabs_ = slab;
+  memory_size_ += slab_size;
+  pos_ = reinterpret_cast<uint8_t *>(slab + 1);
+  end_ = reinterpret_cast<uint8_t *>(slab) + slab_size;
+  return Allocate(size, align);
+}
+
+}  // namespace data
+}  // namespace coin
@@ -0,0 +1,148 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <cstddef>
+#include <cstdint>
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace coin {
+namespace data {
+
+/**
+ * Monotonic allocator carving allocations out of large slabs.
+ *
+ * Allocate() bumps a pointer, single allocations are never freed. Reset()
+ * releases everything at once and keeps the newest slab for reuse, so
+ * decoding one block after another settles on a single slab. Not thread
+ * safe.
+ */
+class Arena {
+ public:
+  static const size_t DEFAULT_SLAB_SIZE = 64 * 1024;
+
+  /// Create an arena, the first slab is allocated on the first Allocate().
+  explicit Arena(size_t slab_size = DEFAULT_SLAB_SIZE)
+      : slab_size_(slab_size) {}
+
+  ~Arena();
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  /**
+   * Allocate memory living until Reset() or destruction.
+   *
+   * @param size Number of bytes.
+   * @param align Alignment, a power of two.
+   *
+   * @return Memory, throws std::bad_alloc if a slab cannot be allocated.
+   */
+  void *Allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+    uintptr_t p = (reinterpret_cast<uintptr_t>(pos_) + align - 1) &
+                  ~static_cast<uintptr_t>(align - 1);
+    if (pos_ == nullptr || size > static_cast<size_t>(end_ - pos_) ||
+        p + size > reinterpret_cast<uintptr_t>(end_)) {
+      return AllocateSlow(size, align);
+    }
+    pos_ = reinterpret_cast<uint8_t *>(p + size);
+    used_ += size;
+    return reinterpret_cast<void *>(p);
+  }
+
+  /// Release every allocation, keep the newest slab.
+  void Reset();
+
+  /// Bytes handed out since the last Reset().
+  size_t get_used_size() const { return used_; }
+
+  /// Bytes held in slabs.
+  size_t get_memory_size() const { return memory_size_; }
+
+ private:
+  struct Slab {
+    Slab *next;
+    size_t size;  // Including this header.
+  };
+
+  /// Start a new slab large enough for the allocation.
+  void *AllocateSlow(size_t size, size_t align);
+
+ private:
+  size_t slab_size_;
+  Slab *slabs_ = nullptr;  // Newest first.
+  uint8_t *pos_ = nullptr;
+  uint8_t *end_ = nullptr;
+  size_t used_ = 0;
+  size_t memory_size_ = 0;
+};
+
+/**
+ * Standard allocator drawing from an Arena, or from the heap when it has
+ * none, so containers keep one type either way.
+ *
+ * Elements default-constructed by a container, e.g. by resize(), receive
+ * the arena if they have a constructor taking one, so a vector of records
+ * read in place fills the same arena. A copy of a container goes to the
+ * heap and may outlive Arena::Reset().
+ */
+template <typename T>
+class ArenaAllocator {
+ public:
+  typedef T value_type;
+
+  ArenaAllocator(Arena *arena = nullptr) : arena_(arena) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &another)
+      : arena_(another.get_arena()) {}
+
+  T *allocate(size_t n) {
+    if (arena_) {
+      return static_cast<T *>(arena_->Allocate(n * sizeof(T), alignof(T)));
+    }
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T *p, size_t) {
+    if (!arena_) ::operator delete(p);
+  }
+
+  template <typename U>
+  typename std::enable_if<std::is_class<U>::value &&
+                          std::is_constructible<U, Arena *>::value>::type
+  construct(U *p) {
+    ::new (static_cast<void *>(p)) U(arena_);
+  }
+
+  template <typename U, typename... Args>
+  void construct(U *p, Args &&... args) {
+    ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+  }
+
+  ArenaAllocator select_on_container_copy_construction() const {
+    return ArenaAllocator();
+  }
+
+  Arena *get_arena() const { return arena_; }
+
+ private:
+  Arena *arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+  return a.get_arena() == b.get_arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+  return !(a == b);
+}
+
+}  // namespace data
+}  // namespace coin
+
+#endif
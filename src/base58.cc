@@ -12,26 +12,29 @@ namespace base58 {
 static const char *BASE58_CHARS =
     "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
 
-std::string EncodeBase58(const unsigned char *pbegin,
-                         const unsigned char *pend) {
+size_t EncodeBase58(const unsigned char *pbegin, const unsigned char *pend,
+                    char *psz, size_t size) {
   // Skip & count leading zeroes.
-  int zeroes = 0;
-  int length = 0;
+  size_t zeroes = 0;
+  size_t length = 0;
   while (pbegin != pend && *pbegin == 0) {
     pbegin++;
     zeroes++;
   }
-  // Allocate enough space in big-endian base58 representation.
-  int size =
+  // Big-endian base58 representation is built in the tail of psz.
+  size_t b58_size =
       (pend - pbegin) * 138 / 100 + 1;  // log(256) / log(58), rounded up.
-  std::vector<unsigned char> b58(size);
+  if (zeroes + b58_size > size) return 0;
+  unsigned char *b58 = reinterpret_cast<unsigned char *>(psz) + size - b58_size;
+  std::memset(b58, 0, b58_size);
   // Process the bytes.
   while (pbegin != pend) {
     int carry = *pbegin;
-    int i = 0;
+    size_t i = 0;
     // Apply "b58 = b58 * 256 + ch".
-    for (std::vector<unsigned char>::reverse_iterator it = b58.rbegin();
-         (carry != 0 || i < length) && (it != b58.rend()); it++, i++) {
+    for (unsigned char *it = b58 + b58_size;
+         (carry != 0 || i < length) && (it != b58); i++) {
+      --it;
       carry += 256 * (*it);
       *it = carry % 58;
       carry /= 58;
@@ -42,13 +45,20 @@ std::string EncodeBase58(const unsigned char *pbegin,
     pbegin++;
   }
   // Skip leading zeroes in base58 result.
-  std::vector<unsigned char>::iterator it = b58.begin() + (size - length);
-  while (it != b58.end() && *it == 0) it++;
-  // Translate the result into a string.
-  std::string str;
-  str.reserve(zeroes + (b58.end() - it));
-  str.assign(zeroes, '1');
-  while (it != b58.end()) str += BASE58_CHARS[*(it++)];
+  const unsigned char *it = b58 + (b58_size - length);
+  const unsigned char *end = b58 + b58_size;
+  while (it != end && *it == 0) it++;
+  // Translate the result to the front, never overtaking unread digits.
+  std::memset(psz, '1', zeroes);
+  char *out = psz + zeroes;
+  while (it != end) *(out++) = BASE58_CHARS[*(it++)];
+  return out - psz;
+}
+
+std::string EncodeBase58(const unsigned char *pbegin,
+                         const unsigned char *pend) {
+  std::string str(GetMaxEncodedSize(pend - pbegin), '\0');
+  str.resize(EncodeBase58(pbegin, pend, &str[0], str.size()));
   return str;
 }
 
@@ -1,6 +1,8 @@
 #ifndef __BASE58_H__
 #define __BASE58_H__
 
+#include <cstddef>
+
 #include <string>
 #include <vector>
 
@@ -9,6 +11,24 @@ namespace base58 {
 std::string EncodeBase58(const unsigned char *pbegin,
                          const unsigned char *pend);
 
+/**
+ * Encode into a caller provided buffer, no memory is allocated.
+ *
+ * @param pbegin Data begin.
+ * @param pend Data end.
+ * @param psz Output characters, not null terminated.
+ * @param size Size of psz, at least GetMaxEncodedSize(pend - pbegin).
+ *
+ * @return Number of characters written, 0 if psz is too small.
+ */
+size_t EncodeBase58(const unsigned char *pbegin, const unsigned char *pend,
+                    char *psz, size_t size);
+
+/// Upper bound of encoded size for `size` bytes of data.
+constexpr size_t GetMaxEncodedSize(size_t size) {
+  return size + size * 138 / 100 + 1;
+}
+
 bool DecodeBase58(const char *psz, std::vector<unsigned char> &vch);
 
 std::string EncodeBase58(const std::vector<unsigned char> &vch);
@@ -4,6 +4,7 @@
 #include <cinttypes>
 
 #include "data_value.h"
+#include "hex.h"
 
 namespace coin {
 namespace bn {
@@ -19,24 +20,34 @@ class BigNum {
 
   explicit BigNum(const uint8_t *value) { memcpy(digits_, value, N); }
 
-  static BigNum<N> FromString(const std::string &str) {
-    assert(str.size() == N * 2);
-
+  /**
+   * Parse a hex string of 2 * N digits.
+   *
+   * @param str Hex string.
+   * @param num Parsed number, unchanged on failure.
+   *
+   * @return False if the length is wrong or a character is not a hex digit.
+   */
+  static bool FromString(const std::string &str, BigNum<N> &num) {
     uint8_t val[N];
-    for (int i = 0; i < str.size(); i += 2) {
-      char digit[3];
-      digit[0] = str[i];
-      digit[1] = str[i + 1];
-      digit[2] = '\0';
-      int val_scan;
-      sscanf(digit, "%x", &val_scan);
-      val[i / 2] = val_scan % 256;
-    }
+    if (str.size() != N * 2 || !hex::Decode(str.data(), N, val)) return false;
+    num.Assign(val);
+    return true;
+  }
 
-    BigNum<N> num(val);
+  /// Parse a hex string of 2 * N digits, zero if it is not one.
+  static BigNum<N> FromString(const std::string &str) {
+    uint8_t zero[N] = {0};
+    BigNum<N> num(zero);
+    bool valid = FromString(str, num);
+    assert(valid && "Invalid hex number");
+    (void)valid;
     return num;
   }
 
+  /// Hex string of 2 * N lowercase digits.
+  std::string ToString() const { return hex::Encode(digits_, N); }
+
   void Assign(const uint8_t *value) {
     memcpy(digits_, value, N * sizeof(uint8_t));
   }
@@ -49,21 +60,13 @@ class BigNum {
   }
 
   bool operator==(const BigNum &another) const {
-    for (int i = 0; i < N; ++i) {
-      if (digits_[i] != another.digits_[i]) return false;
-    }
-    return true;
+    return memcmp(digits_, another.digits_, N) == 0;
   }
 
   bool operator!=(const BigNum &another) const { return !(*this == another); }
 
   bool operator<(const BigNum &another) const {
-    for (int i = 0; i < N; ++i) {
-      if (digits_[i] != another.digits_[i]) {
-        return digits_[i] < another.digits_[i];
-      }
-    }
-    return false;
+    return memcmp(digits_, another.digits_, N) < 0;
   }
 
   bool operator>(const BigNum &another) const {
@@ -83,6 +86,16 @@ typedef BigNum<32> HashNum;
 
 namespace data {
 
+namespace utils {
+
+/// BigNum is its digits, arrays of them are written in bulk.
+template <int N>
+struct IsRawBytes<bn::BigNum<N>> : std::true_type {
+  static_assert(sizeof(bn::BigNum<N>) == N, "BigNum has no padding");
+};
+
+}  // namespace utils
+
 template <int N>
 class Value<bn::BigNum<N>> {
  public:
@@ -99,10 +112,12 @@ class Value<bn::BigNum<N>> {
   }
 
   template <typename Stream>
-  void ReadFromStream(Stream &s) const {
+  void ReadFromStream(Stream &s) {
     s.read((char *)num_.get_data(), sizeof(uint8_t) * N);
   }
 
+  size_t GetSerializedSize(Format = Format::Legacy) const { return N; }
+
   std::vector<uint8_t> MakeStreamData() const {
     std::vector<uint8_t> data(N);
     memcpy(data.data(), num_.get_data(), N * sizeof(uint8_t));
@@ -37,12 +37,35 @@ void Block::set_difficult(const bn::HashNum &difficult) {
 
 const bn::HashNum &Block::get_difficult() const { return difficult_; }
 
-std::vector<Transaction> &Block::get_trans() { return trans_; }
+Block::Transactions &Block::get_trans() { return trans_; }
 
-const std::vector<Transaction> &Block::get_trans() const { return trans_; }
+const Block::Transactions &Block::get_trans() const { return trans_; }
 
-void Block::MakeHash() {
+size_t Block::GetSerializedSize(data::Format format) const {
+  size_t size = sizeof(version_) + sizeof(timestamp_) + sizeof(height_) +
+                sizeof(block_hash_) + sizeof(prev_hash_) +
+                sizeof(merkle_root_hash_) + sizeof(nonce_) +
+                sizeof(difficult_);
+  return size + data::GetVectorSize(trans_, format);
+}
+
+void Block::MakeHash() { block_hash_ = CalcHash(); }
+
+bn::HashNum Block::CalcHash() const {
+  return CalcHash(MakeMidstate(), nonce_);
+}
+
+Hash256 Block::MakeMidstate() const {
+  Hash256Builder hash_builder;
+  hash_builder << data::MakeValue(prev_hash_)
+               << data::MakeValue(merkle_root_hash_);
+  return hash_builder.get_algo();
+}
 
+bn::HashNum Block::CalcHash(const Hash256 &midstate, uint32_t nonce) const {
+  Hash256Builder hash_builder(midstate);
+  hash_builder << data::MakeValue(nonce) << data::MakeValue(difficult_);
+  return bn::HashNum(hash_builder.FinalValue().value.data());
 }
 
 }  // namespace blk
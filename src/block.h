@@ -5,6 +5,7 @@
 
 #include "big_num.h"
 #include "data_value.h"
+#include "hash_utils.h"
 #include "transaction.h"
 
 namespace coin {
@@ -15,8 +16,23 @@ namespace blk {
  */
 class Block {
  public:
+  typedef std::vector<Transaction, data::ArenaAllocator<Transaction>>
+      Transactions;
+
+  /**
+   * Create an empty block.
+   *
+   * With an arena, Unserialize() reads the transactions and their fields
+   * into it, so decoding a block costs a few slab allocations and the
+   * block must not be used after Arena::Reset(). A copy lives on the heap.
+   *
+   * @param arena Arena to allocate from, or nullptr for the heap.
+   */
+  explicit Block(data::Arena *arena = nullptr)
+      : trans_(data::ArenaAllocator<Transaction>(arena)) {}
+
   template <typename Stream>
-  void Serialize(Stream &s) {
+  void Serialize(Stream &s) const {
     data::MakeValue(version_).WriteToStream(s);
     data::MakeValue(timestamp_).WriteToStream(s);
     data::MakeValue(height_).WriteToStream(s);
@@ -25,22 +41,27 @@ class Block {
     data::MakeValue(merkle_root_hash_).WriteToStream(s);
     data::MakeValue(nonce_).WriteToStream(s);
     data::MakeValue(difficult_).WriteToStream(s);
-    data::MakeValue(trans_).WriteToStream(s);
+    data::WriteVector(s, trans_);
   }
 
   template <typename Stream>
   void Unserialize(Stream &s) {
-    data::MakeValue(version_).ReadFromStream(s);
-    data::MakeValue(timestamp_).ReadFromStream(s);
-    data::MakeValue(height_).ReadFromStream(s);
-    data::MakeValue(block_hash_).ReadFromStream(s);
-    data::MakeValue(prev_hash_).ReadFromStream(s);
-    data::MakeValue(merkle_root_hash_).ReadFromStream(s);
-    data::MakeValue(nonce_).ReadFromStream(s);
-    data::MakeValue(difficult_).ReadFromStream(s);
-    data::MakeValue(trans_).ReadFromStream(s);
+    version_ = data::ReadValue<int>(s);
+    timestamp_ = data::ReadValue<time_t>(s);
+    height_ = data::ReadValue<uint32_t>(s);
+    ReadHash(s, block_hash_);
+    ReadHash(s, prev_hash_);
+    ReadHash(s, merkle_root_hash_);
+    nonce_ = data::ReadValue<uint32_t>(s);
+    ReadHash(s, difficult_);
+    // At least type, timestamp, and the lengths of the public key, merkle
+    // hash and lists.
+    data::ReadVector(s, trans_, sizeof(int) + sizeof(time_t) + 4);
   }
 
+  /// Number of bytes Serialize() writes, computed without serializing.
+  size_t GetSerializedSize(data::Format format = data::Format::Legacy) const;
+
   void set_block_hash(const bn::HashNum &num);
   const bn::HashNum &get_block_hash() const;
 
@@ -62,11 +83,44 @@ class Block {
   void set_difficult(const bn::HashNum &difficult);
   const bn::HashNum &get_difficult() const;
 
-  std::vector<Transaction> &get_trans();
-  const std::vector<Transaction> &get_trans() const;
+  Transactions &get_trans();
+  const Transactions &get_trans() const;
 
+  /// Calculate block hash value and save it as block hash.
   void MakeHash();
 
+  /// Calculate block hash value from prev hash, merkle root, nonce and
+  /// difficult.
+  bn::HashNum CalcHash() const;
+
+  /**
+   * Absorb the header values in front of the nonce.
+   *
+   * The prefix is exactly one SHA-256 block, so hashing another nonce from
+   * the midstate skips a compression round.
+   *
+   * @return Hash midstate for CalcHash(midstate, nonce).
+   */
+  Hash256 MakeMidstate() const;
+
+  /**
+   * Calculate block hash value with another nonce.
+   *
+   * @param midstate Midstate from MakeMidstate().
+   * @param nonce Nonce value.
+   *
+   * @return Block hash value.
+   */
+  bn::HashNum CalcHash(const Hash256 &midstate, uint32_t nonce) const;
+
+ private:
+  template <typename Stream>
+  static void ReadHash(Stream &s, bn::HashNum &hash) {
+    data::Value<bn::HashNum> value;
+    value.ReadFromStream(s);
+    hash = value.get_num();
+  }
+
  private:
   // Block base info.
   int version_ = 1;
@@ -78,7 +132,7 @@ class Block {
   bn::HashNum merkle_root_hash_;
   uint32_t nonce_ = 0;
   bn::HashNum difficult_;
-  std::vector<Transaction> trans_;
+  Transactions trans_;
 };
 
 }  // namespace blk
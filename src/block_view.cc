@@ -0,0 +1,73 @@
+#include "block_view.h"
+
+namespace coin {
+namespace blk {
+
+bool BlockView::Parse(const uint8_t *p, size_t size, data::Format format) {
+  p_ = nullptr;
+  size_ = 0;
+  tx_offsets_.clear();
+  data::ByteReader reader(p, size);
+  reader.set_format(format);
+  reader.Skip(HEADER_SIZE);
+  uint32_t trans_n = data::ReadLength(reader);
+  if (!reader.good()) return false;
+  size_t offset = reader.get_position();
+  for (uint32_t i = 0; i < trans_n; ++i) {
+    size_t tx_size =
+        TransactionView::GetSerializedSize(p + offset, size - offset, format);
+    if (tx_size == 0) {
+      tx_offsets_.clear();
+      return false;
+    }
+    tx_offsets_.push_back(offset);
+    offset += tx_size;
+  }
+  p_ = p;
+  size_ = offset;
+  format_ = format;
+  return true;
+}
+
+int BlockView::get_version() const { return ReadAt<int>(0); }
+
+time_t BlockView::get_timestamp() const {
+  return ReadAt<time_t>(TIMESTAMP_OFFSET);
+}
+
+uint32_t BlockView::get_height() const {
+  return ReadAt<uint32_t>(HEIGHT_OFFSET);
+}
+
+uint32_t BlockView::get_nonce() const { return ReadAt<uint32_t>(NONCE_OFFSET); }
+
+data::ByteSpan BlockView::GetTransactionBytes(size_t index) const {
+  size_t end =
+      index + 1 < tx_offsets_.size() ? tx_offsets_[index + 1] : size_;
+  return data::ByteSpan(p_ + tx_offsets_[index], end - tx_offsets_[index]);
+}
+
+bool BlockView::GetTransaction(size_t index, TransactionView &view) const {
+  data::ByteSpan bytes = GetTransactionBytes(index);
+  return view.Parse(bytes.data, bytes.size, format_);
+}
+
+BlockView::TransactionViews BlockView::IndexTransactions(
+    data::Arena *arena) const {
+  TransactionViews views{data::ArenaAllocator<TransactionView>(arena)};
+  views.reserve(tx_offsets_.size());
+  for (size_t i = 0; i < tx_offsets_.size(); ++i) {
+    views.emplace_back(arena);
+    GetTransaction(i, views.back());
+  }
+  return views;
+}
+
+void BlockView::ToBlock(Block &block) const {
+  data::ByteReader reader(p_, size_);
+  reader.set_format(format_);
+  block.Unserialize(reader);
+}
+
+}  // namespace blk
+}  // namespace coin
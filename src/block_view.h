@@ -0,0 +1,113 @@
+#ifndef __BLOCK_VIEW_H__
+#define __BLOCK_VIEW_H__
+
+#include <cstdint>
+#include <ctime>
+
+#include <vector>
+
+#include "arena.h"
+#include "big_num.h"
+#include "block.h"
+#include "byte_stream.h"
+#include "transaction_view.h"
+
+namespace coin {
+namespace blk {
+
+/**
+ * Read-only view of a serialized Block.
+ *
+ * Parse() checks the record and builds a table of transaction offsets in
+ * one pass. Header fields are decoded from their fixed offsets on demand,
+ * a transaction is indexed only when GetTransaction() asks for it. The
+ * bytes must outlive the view.
+ */
+class BlockView {
+ public:
+  /**
+   * Index the block at the start of a byte range.
+   *
+   * @param p Serialized block, e.g. from a ByteWriter or a MappedFile.
+   * @param size Number of bytes available at p.
+   * @param format Format the block was serialized in.
+   *
+   * @return False if the record or one of its transactions is truncated.
+   */
+  bool Parse(const uint8_t *p, size_t size,
+             data::Format format = data::Format::Legacy);
+
+  /// Serialized bytes of the block.
+  data::ByteSpan get_bytes() const { return data::ByteSpan(p_, size_); }
+
+  int get_version() const;
+  time_t get_timestamp() const;
+  uint32_t get_height() const;
+  bn::HashNum get_block_hash() const { return GetHash(BLOCK_HASH_OFFSET); }
+  bn::HashNum get_prev_hash() const { return GetHash(PREV_HASH_OFFSET); }
+  bn::HashNum get_merkle_root_hash() const {
+    return GetHash(MERKLE_ROOT_HASH_OFFSET);
+  }
+  uint32_t get_nonce() const;
+  bn::HashNum get_difficult() const { return GetHash(DIFFICULT_OFFSET); }
+
+  size_t transaction_count() const { return tx_offsets_.size(); }
+
+  /// Serialized bytes of transaction `index`.
+  data::ByteSpan GetTransactionBytes(size_t index) const;
+
+  /// Index transaction `index` into view, Parse() already checked it.
+  bool GetTransaction(size_t index, TransactionView &view) const;
+
+  typedef std::vector<TransactionView, data::ArenaAllocator<TransactionView>>
+      TransactionViews;
+
+  /**
+   * Index every transaction.
+   *
+   * With an arena the views and their offset tables are carved out of its
+   * slabs, a whole block costs a few allocations and Arena::Reset() frees
+   * it at once. The views must not be used after that.
+   *
+   * @param arena Arena to allocate from, or nullptr for the heap.
+   *
+   * @return One view for each transaction.
+   */
+  TransactionViews IndexTransactions(data::Arena *arena = nullptr) const;
+
+  /// Decode into a Block.
+  void ToBlock(Block &block) const;
+
+ private:
+  // Offsets of the fixed-width header fields, in Serialize() order.
+  static const size_t TIMESTAMP_OFFSET = sizeof(int);
+  static const size_t HEIGHT_OFFSET = TIMESTAMP_OFFSET + sizeof(time_t);
+  static const size_t BLOCK_HASH_OFFSET = HEIGHT_OFFSET + sizeof(uint32_t);
+  static const size_t PREV_HASH_OFFSET =
+      BLOCK_HASH_OFFSET + sizeof(bn::HashNum);
+  static const size_t MERKLE_ROOT_HASH_OFFSET =
+      PREV_HASH_OFFSET + sizeof(bn::HashNum);
+  static const size_t NONCE_OFFSET =
+      MERKLE_ROOT_HASH_OFFSET + sizeof(bn::HashNum);
+  static const size_t DIFFICULT_OFFSET = NONCE_OFFSET + sizeof(uint32_t);
+  static const size_t HEADER_SIZE = DIFFICULT_OFFSET + sizeof(bn::HashNum);
+
+  bn::HashNum GetHash(size_t offset) const { return bn::HashNum(p_ + offset); }
+
+  template <typename T>
+  T ReadAt(size_t offset) const {
+    data::ByteReader reader(p_ + offset, size_ - offset);
+    return data::ReadValue<T>(reader);
+  }
+
+  const uint8_t *p_ = nullptr;
+  size_t size_ = 0;
+  data::Format format_ = data::Format::Legacy;
+  // Start of each transaction.
+  std::vector<size_t> tx_offsets_;
+};
+
+}  // namespace blk
+}  // namespace coin
+
+#endif
@@ -0,0 +1,34 @@
+#include "byte_stream.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace coin {
+namespace data {
+
+std::vector<uint8_t> ByteWriter::Release() {
+  assert(!fixed_);
+  buffer_.resize(size_);
+  std::vector<uint8_t> result;
+  result.swap(buffer_);
+  data_ = nullptr;
+  capacity_ = 0;
+  Clear();
+  return result;
+}
+
+bool ByteWriter::Grow(size_t size) {
+  if (fixed_ || fail_) {
+    fail_ = true;
+    return false;
+  }
+  // Doubling keeps appends amortized O(1).
+  size_t capacity = std::max(size_ + size, std::max<size_t>(capacity_ * 2, 64));
+  buffer_.resize(capacity);
+  data_ = buffer_.data();
+  capacity_ = capacity;
+  return true;
+}
+
+}  // namespace data
+}  // namespace coin
@@ -0,0 +1,296 @@
+#ifndef __BYTE_STREAM_H__
+#define __BYTE_STREAM_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <string>
+#include <vector>
+
+#include "data_value.h"
+
+namespace coin {
+namespace data {
+
+/// Bytes inside a buffer owned by someone else.
+struct ByteSpan {
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+
+  ByteSpan() {}
+  ByteSpan(const uint8_t *p, size_t n) : data(p), size(n) {}
+
+  std::vector<uint8_t> ToVector() const {
+    return std::vector<uint8_t>(data, data + size);
+  }
+
+  std::string ToString() const {
+    return std::string(reinterpret_cast<const char *>(data), size);
+  }
+};
+
+/**
+ * Stream writing into a byte buffer.
+ *
+ * Satisfies the `Stream` concept of `Value<T>::WriteToStream` and the
+ * `Serialize` methods. write() is inlined, so the fixed-size fields of a
+ * record become plain stores. The writer either owns a buffer that grows
+ * on demand, or writes into a caller's buffer of fixed capacity, where a
+ * write that does not fit sets the fail flag and later writes do nothing.
+ */
+class ByteWriter {
+ public:
+  /// Growable writer owning its buffer.
+  ByteWriter() {}
+
+  /// Fixed writer into `capacity` bytes at `p`.
+  ByteWriter(uint8_t *p, size_t capacity)
+      : data_(p), capacity_(capacity), fixed_(true) {}
+
+  ByteWriter(const ByteWriter &) = delete;
+  ByteWriter &operator=(const ByteWriter &) = delete;
+
+  ByteWriter &write(const char *p, size_t size) {
+    if ((fail_ || size > capacity_ - size_) && !Grow(size)) return *this;
+    memcpy(data_ + size_, p, size);
+    size_ += size;
+    return *this;
+  }
+
+  /// Make room for `size` more bytes, growable writers only.
+  void Reserve(size_t size) {
+    if (size > capacity_ - size_) Grow(size);
+  }
+
+  /// Forget the written bytes and the fail flag, keep the buffer.
+  void Clear() {
+    size_ = 0;
+    fail_ = false;
+  }
+
+  /// Move the written bytes out of a growable writer and clear it.
+  std::vector<uint8_t> Release();
+
+  /// True if every write fit.
+  bool good() const { return !fail_; }
+
+  /// Encoding of lengths and compact integers, Legacy by default.
+  Format get_format() const { return format_; }
+  void set_format(Format format) { format_ = format; }
+
+  const uint8_t *get_data() const { return data_; }
+  size_t get_size() const { return size_; }
+
+ private:
+  /// Grow the owned buffer for `size` more bytes, or set the fail flag.
+  bool Grow(size_t size);
+
+ private:
+  std::vector<uint8_t> buffer_;
+  uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+  bool fixed_ = false;
+  bool fail_ = false;
+  Format format_ = Format::Legacy;
+};
+
+/**
+ * Stream counting the bytes written to it and discarding them.
+ *
+ * Serializing into a SizeCounter measures any record that has no
+ * GetSerializedSize() of its own.
+ */
+class SizeCounter {
+ public:
+  SizeCounter &write(const char *, size_t size) {
+    size_ += size;
+    return *this;
+  }
+
+  bool good() const { return true; }
+
+  Format get_format() const { return format_; }
+  void set_format(Format format) { format_ = format; }
+
+  size_t get_size() const { return size_; }
+
+ private:
+  size_t size_ = 0;
+  Format format_ = Format::Legacy;
+};
+
+/**
+ * Bounds-checked stream reading from a byte range it does not own.
+ *
+ * Satisfies the `Stream` concept of `Value<T>::ReadFromStream` and the
+ * `Unserialize` methods. A read past the end sets the fail flag and fills
+ * the destination with zeros, so a truncated length prefix reads as 0
+ * instead of sizing a huge allocation. Later reads return zeros as well.
+ */
+class ByteReader {
+ public:
+  ByteReader(const uint8_t *p, size_t size) : data_(p), size_(size) {}
+
+  explicit ByteReader(const std::vector<uint8_t> &data)
+      : data_(data.data()), size_(data.size()) {}
+
+  ByteReader &read(char *p, size_t size) {
+    if (fail_ || size > size_ - pos_) {
+      fail_ = true;
+      memset(p, 0, size);
+      return *this;
+    }
+    memcpy(p, data_ + pos_, size);
+    pos_ += size;
+    return *this;
+  }
+
+  /**
+   * Consume `size` bytes without copying them.
+   *
+   * @param size Number of bytes.
+   *
+   * @return Pointer into the underlying range, valid as long as the range,
+   * or nullptr and the fail flag set if fewer bytes remain.
+   */
+  const uint8_t *Skip(size_t size) {
+    if (fail_ || size > size_ - pos_) {
+      fail_ = true;
+      return nullptr;
+    }
+    const uint8_t *p = data_ + pos_;
+    pos_ += size;
+    return p;
+  }
+
+  /// True if no read ran past the end and no value was malformed.
+  bool good() const { return !fail_; }
+
+  /// Set the fail flag, e.g. on a malformed value. Later reads return zeros.
+  void Fail() { fail_ = true; }
+
+  /// Encoding of lengths and compact integers, Legacy by default.
+  Format get_format() const { return format_; }
+  void set_format(Format format) { format_ = format; }
+
+  /// True if every byte has been read.
+  bool eof() const { return pos_ == size_; }
+
+  size_t get_position() const { return pos_; }
+  size_t get_remaining() const { return size_ - pos_; }
+
+ private:
+  const uint8_t *data_;
+  size_t size_;
+  size_t pos_ = 0;
+  bool fail_ = false;
+  Format format_ = Format::Legacy;
+};
+
+/// Consume a length-prefixed string or buffer without copying it.
+inline ByteSpan ReadSpan(ByteReader &reader) {
+  ByteSpan span;
+  span.size = ReadLength(reader);
+  span.data = reader.Skip(span.size);
+  if (!span.data) span.size = 0;
+  return span;
+}
+
+/**
+ * Tagged records.
+ *
+ * A tagged record starts with one byte holding its Format value, so a
+ * reader finds the encoding in the record itself and records in different
+ * formats can be stored side by side.
+ */
+
+/// Write a tagged record in the format of the writer.
+template <typename T>
+void WriteTaggedRecord(ByteWriter &writer, const T &record) {
+  uint8_t tag = static_cast<uint8_t>(writer.get_format());
+  writer.write((const char *)&tag, sizeof(tag));
+  record.Serialize(writer);
+}
+
+/**
+ * Read a tagged record in whatever format it was written.
+ *
+ * @param p Record, exactly one tagged T.
+ * @param size Size of the record.
+ * @param record Output record.
+ * @param format Receives the format of the record, or nullptr.
+ *
+ * @return False if the tag is unknown, the record is truncated or has
+ * trailing bytes.
+ */
+template <typename T>
+bool ReadTaggedRecord(const uint8_t *p, size_t size, T &record,
+                      Format *format = nullptr) {
+  if (size == 0 || p[0] > static_cast<uint8_t>(Format::Compact)) {
+    return false;
+  }
+  ByteReader reader(p + 1, size - 1);
+  reader.set_format(static_cast<Format>(p[0]));
+  record.Unserialize(reader);
+  if (!reader.good() || !reader.eof()) return false;
+  if (format) *format = reader.get_format();
+  return true;
+}
+
+/**
+ * Rewrite a tagged record in another format, whatever its current one.
+ *
+ * @param p Record, exactly one tagged T.
+ * @param size Size of the record.
+ * @param to Format to write.
+ * @param out Tagged record in format `to`.
+ *
+ * @return False if the record cannot be read.
+ */
+template <typename T>
+bool ConvertFormat(const uint8_t *p, size_t size, Format to,
+                   std::vector<uint8_t> &out) {
+  T record;
+  if (!ReadTaggedRecord(p, size, record)) return false;
+  ByteWriter writer;
+  writer.set_format(to);
+  writer.Reserve(1 + record.GetSerializedSize(to));
+  WriteTaggedRecord(writer, record);
+  out = writer.Release();
+  return true;
+}
+
+/**
+ * Convert an untagged record to another format, e.g. to migrate records
+ * stored in the Legacy format before they were tagged.
+ *
+ * @param p Record, exactly one serialized T.
+ * @param size Size of the record.
+ * @param from Format of the record.
+ * @param to Format to write.
+ * @param out Record in format `to`.
+ *
+ * @return False if the record is truncated or has trailing bytes.
+ */
+template <typename T>
+bool ConvertFormat(const uint8_t *p, size_t size, Format from, Format to,
+                   std::vector<uint8_t> &out) {
+  T record;
+  ByteReader reader(p, size);
+  reader.set_format(from);
+  record.Unserialize(reader);
+  if (!reader.good() || !reader.eof()) return false;
+  ByteWriter writer;
+  writer.set_format(to);
+  writer.Reserve(record.GetSerializedSize(to));
+  record.Serialize(writer);
+  out = writer.Release();
+  return true;
+}
+
+}  // namespace data
+}  // namespace coin
+
+#endif
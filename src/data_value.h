@@ -6,10 +6,16 @@
 #include <cassert>
 #include <cstring>
 
+#include <array>
 #include <functional>
+#include <limits>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "arena.h"
+
 namespace coin {
 namespace data {
 
@@ -20,6 +26,10 @@ typedef std::function<void(ConstDataIterator, ConstDataIterator)> WithFuncType;
 
 namespace utils {
 
+uint64_t HostToNet(uint64_t value);
+
+uint64_t NetToHost(uint64_t value_n);
+
 template <typename IntType>
 IntType HostToNet(const IntType value) {
   size_t size = sizeof(value);
@@ -31,6 +41,13 @@ IntType HostToNet(const IntType value) {
     case 4:
       value_n = htonl(value);
       break;
+    case 8: {
+      uint64_t wide = 0;
+      memcpy(&wide, &value, sizeof(IntType));
+      wide = HostToNet(wide);
+      memcpy(&value_n, &wide, sizeof(IntType));
+      break;
+    }
   }
   return value_n;
 }
@@ -46,17 +63,264 @@ IntType NetToHost(IntType value_n) {
     case 4:
       value = ntohl(value);
       break;
+    case 8: {
+      uint64_t wide = 0;
+      memcpy(&wide, &value_n, sizeof(IntType));
+      wide = NetToHost(wide);
+      memcpy(&value, &wide, sizeof(IntType));
+      break;
+    }
   }
   return value;
 }
 
-uint64_t HostToNet(uint64_t value);
+/// Map signed values to unsigned so small magnitudes stay small.
+inline uint64_t ZigZagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
 
-uint64_t NetToHost(uint64_t value_n);
+inline int64_t ZigZagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
 
 }  // namespace utils
 
-template <typename T>
+/**
+ * Encoding of lengths, counts and the integer fields marked as compact.
+ *
+ * The values are stored with records, so they must not change.
+ */
+enum class Format : uint8_t {
+  Legacy = 0,   // 4-byte big-endian lengths, full-width integers.
+  Compact = 1,  // Base-128 varints, zig-zag for signed fields.
+};
+
+namespace utils {
+
+template <typename Stream>
+auto GetFormat(const Stream &s, int) -> decltype(s.get_format()) {
+  return s.get_format();
+}
+
+template <typename Stream>
+Format GetFormat(const Stream &, long) {
+  return Format::Legacy;
+}
+
+}  // namespace utils
+
+/// Format of a stream: its get_format() if it has one, otherwise Legacy.
+template <typename Stream>
+Format GetStreamFormat(const Stream &s) {
+  return utils::GetFormat(s, 0);
+}
+
+namespace utils {
+
+/// Bytes left in a stream with get_remaining(), `unknown` for others.
+template <typename Stream>
+auto GetRemaining(const Stream &s, size_t, int)
+    -> decltype(s.get_remaining()) {
+  return s.get_remaining();
+}
+
+template <typename Stream>
+size_t GetRemaining(const Stream &, size_t unknown, long) {
+  return unknown;
+}
+
+}  // namespace utils
+
+/**
+ * Number of records to reserve before reading `count` of them.
+ *
+ * The count is untrusted, so it is bounded by the bytes a stream with
+ * get_remaining() has left. Other streams reserve nothing.
+ *
+ * @param s Stream.
+ * @param count Number of records the stream claims.
+ * @param min_size Smallest serialized size of a record.
+ */
+template <typename Stream>
+size_t GetReserveCount(const Stream &s, size_t count, size_t min_size) {
+  size_t remaining = utils::GetRemaining(s, 0, 0);
+  return count < remaining / min_size ? count : remaining / min_size;
+}
+
+namespace utils {
+
+template <typename Stream>
+auto MarkFailed(Stream &s, int) -> decltype(s.Fail()) {
+  return s.Fail();
+}
+
+template <typename Stream>
+void MarkFailed(Stream &, long) {}
+
+}  // namespace utils
+
+/// Set the fail flag of a stream with Fail(), e.g. on a malformed value.
+/// Other streams are left as they are.
+template <typename Stream>
+void MarkStreamFailed(Stream &s) {
+  utils::MarkFailed(s, 0);
+}
+
+/// Maximum size of an encoded varint.
+const size_t MAX_VARINT_SIZE = 10;
+
+/// Number of bytes WriteVarInt() writes for value.
+inline size_t GetVarIntSize(uint64_t value) {
+  size_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+/// Write value 7 bits per byte, low bits first, high bit set on all but
+/// the last byte.
+template <typename Stream>
+void WriteVarInt(Stream &s, uint64_t value) {
+  uint8_t buf[MAX_VARINT_SIZE];
+  size_t size = 0;
+  while (value >= 0x80) {
+    buf[size++] = static_cast<uint8_t>(value) | 0x80;
+    value >>= 7;
+  }
+  buf[size++] = static_cast<uint8_t>(value);
+  s.write((const char *)buf, size);
+}
+
+/// Read a value written by WriteVarInt(). Only the shortest form is
+/// accepted, an overlong form, a value above 64 bits or a missing last byte
+/// reads as 0 and marks the stream failed.
+template <typename Stream>
+uint64_t ReadVarInt(Stream &s) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < MAX_VARINT_SIZE; ++i) {
+    uint8_t byte = 0;
+    s.read((char *)&byte, 1);
+    // The last byte holds bit 63 only.
+    if (i == MAX_VARINT_SIZE - 1 && byte > 1) break;
+    value |= static_cast<uint64_t>(byte & 0x7f) << (7 * i);
+    if ((byte & 0x80) == 0) {
+      // A zero last byte means a shorter form exists.
+      if (byte == 0 && i > 0) break;
+      return value;
+    }
+  }
+  MarkStreamFailed(s);
+  return 0;
+}
+
+/// Write a length or count in the format of the stream.
+template <typename Stream>
+void WriteLength(Stream &s, size_t size) {
+  if (GetStreamFormat(s) == Format::Compact) {
+    WriteVarInt(s, size);
+  } else {
+    uint32_t size_n = utils::HostToNet(static_cast<uint32_t>(size));
+    s.write((const char *)&size_n, sizeof(size_n));
+  }
+}
+
+/// Read a length or count written by WriteLength(). Lengths are limited to
+/// 32 bits in both formats, a longer one reads as 0 and marks the stream
+/// failed.
+template <typename Stream>
+uint32_t ReadLength(Stream &s) {
+  if (GetStreamFormat(s) == Format::Compact) {
+    uint64_t size = ReadVarInt(s);
+    if (size > UINT32_MAX) {
+      MarkStreamFailed(s);
+      return 0;
+    }
+    return static_cast<uint32_t>(size);
+  }
+  uint32_t size_n = 0;
+  s.read((char *)&size_n, sizeof(size_n));
+  return utils::NetToHost(size_n);
+}
+
+/// Number of bytes WriteLength() writes for size.
+inline size_t GetLengthSize(size_t size, Format format) {
+  return format == Format::Compact ? GetVarIntSize(size) : sizeof(uint32_t);
+}
+
+/// Write an integer field: full-width big-endian in the Legacy format, a
+/// varint in the Compact format, zig-zag encoded if IntType is signed.
+template <typename Stream, typename IntType>
+void WriteInt(Stream &s, IntType value) {
+  static_assert(std::is_integral<IntType>::value, "integer field");
+  if (GetStreamFormat(s) == Format::Compact) {
+    WriteVarInt(s, std::is_signed<IntType>::value
+                       ? utils::ZigZagEncode(value)
+                       : static_cast<uint64_t>(value));
+  } else {
+    IntType value_n = utils::HostToNet(value);
+    s.write((const char *)&value_n, sizeof(value_n));
+  }
+}
+
+namespace utils {
+
+/// True if a zig-zag encoded varint is within the range of IntType.
+template <typename IntType>
+bool FitsInt(uint64_t value, std::true_type /* is_signed */) {
+  int64_t decoded = ZigZagDecode(value);
+  return decoded >= static_cast<int64_t>(std::numeric_limits<IntType>::min()) &&
+         decoded <= static_cast<int64_t>(std::numeric_limits<IntType>::max());
+}
+
+/// True if a varint is within the range of IntType.
+template <typename IntType>
+bool FitsInt(uint64_t value, std::false_type /* is_signed */) {
+  return value <= static_cast<uint64_t>(std::numeric_limits<IntType>::max());
+}
+
+}  // namespace utils
+
+/// Read an integer field written by WriteInt(). In the Compact format a
+/// value out of the range of IntType reads as 0 and marks the stream
+/// failed, so each value has a single encoding.
+template <typename IntType, typename Stream>
+IntType ReadInt(Stream &s) {
+  static_assert(std::is_integral<IntType>::value, "integer field");
+  if (GetStreamFormat(s) == Format::Compact) {
+    uint64_t value = ReadVarInt(s);
+    if (!utils::FitsInt<IntType>(value, std::is_signed<IntType>())) {
+      MarkStreamFailed(s);
+      return 0;
+    }
+    return static_cast<IntType>(std::is_signed<IntType>::value
+                                    ? utils::ZigZagDecode(value)
+                                    : value);
+  }
+  IntType value_n = 0;
+  s.read((char *)&value_n, sizeof(value_n));
+  return utils::NetToHost(value_n);
+}
+
+/// Number of bytes WriteInt() writes for value.
+template <typename IntType>
+size_t GetIntSize(IntType value, Format format) {
+  if (format == Format::Legacy) return sizeof(IntType);
+  return GetVarIntSize(std::is_signed<IntType>::value
+                           ? utils::ZigZagEncode(value)
+                           : static_cast<uint64_t>(value));
+}
+
+/**
+ * Serialized form of a value.
+ *
+ * Scalars are written full-width in network byte order. Specializations
+ * cover strings, byte buffers, BigNum, vectors and arrays of any of these,
+ * and objects with Serialize and Unserialize methods.
+ */
+template <typename T, typename Enable = void>
 class Value {
  public:
   T value = 0;
@@ -78,6 +342,10 @@ class Value {
     value = utils::NetToHost(value_n);
   }
 
+  size_t GetSerializedSize(Format = Format::Legacy) const {
+    return sizeof(T);
+  }
+
   std::vector<uint8_t> MakeStreamData() const {
     std::vector<uint8_t> data(sizeof(T));
     T value_stream = utils::HostToNet(value);
@@ -86,33 +354,47 @@ class Value {
   }
 };
 
-template <>
-class Value<std::string> {
+/// Read a length-prefixed string or byte vector into `bytes`, keeping its
+/// allocator. A length beyond what a stream with get_remaining() has left
+/// leaves `bytes` empty and marks the stream failed, before allocating.
+template <typename Stream, typename Bytes>
+void ReadBytes(Stream &s, Bytes &bytes) {
+  uint32_t size = ReadLength(s);
+  if (size > utils::GetRemaining(s, SIZE_MAX, 0)) {
+    bytes.clear();
+    MarkStreamFailed(s);
+    return;
+  }
+  bytes.resize(size);
+  if (size > 0) s.read(reinterpret_cast<char *>(&bytes[0]), size);
+}
+
+/// Strings, std::string or one with another allocator.
+template <typename Alloc>
+class Value<std::basic_string<char, std::char_traits<char>, Alloc>> {
  public:
-  std::string value;
+  typedef std::basic_string<char, std::char_traits<char>, Alloc> String;
+
+  String value;
 
  public:
   Value() {}
-  Value(const std::string &another) : value(another) {}
+  Value(const String &another) : value(another) {}
+  explicit Value(const Alloc &alloc) : value(alloc) {}
 
   template <typename Stream>
   void WriteToStream(Stream &s) const {
-    uint32_t size = value.size();
-    uint32_t size_n = utils::HostToNet(size);
-    s.write((const char *)&size_n, sizeof(size_n));
+    WriteLength(s, value.size());
     s.write(value.c_str(), value.size());
   }
 
   template <typename Stream>
   void ReadFromStream(Stream &s) {
-    uint32_t size_n;
-    s.read((char *)&size_n, sizeof(size_n));
-    uint32_t size = utils::NetToHost(size_n);
-    char *buf = new char[size + 1];
-    s.read(buf, size);
-    buf[size] = '\0';
-    value = buf;
-    delete[] buf;
+    ReadBytes(s, value);
+  }
+
+  size_t GetSerializedSize(Format format = Format::Legacy) const {
+    return GetLengthSize(value.size(), format) + value.size();
   }
 
   std::vector<uint8_t> MakeStreamData() const {
@@ -124,14 +406,16 @@ class Value<std::string> {
   }
 };
 
-template <>
-class Value<std::vector<uint8_t>> {
+/// Byte buffers, std::vector<uint8_t> or one with another allocator.
+template <typename Alloc>
+class Value<std::vector<uint8_t, Alloc>> {
  public:
-  std::vector<uint8_t> value;
+  std::vector<uint8_t, Alloc> value;
 
  public:
   Value() {}
-  Value(const std::vector<uint8_t> &another) : value(another) {}
+  Value(const std::vector<uint8_t, Alloc> &another) : value(another) {}
+  explicit Value(const Alloc &alloc) : value(alloc) {}
 
   void CopyFrom(const uint8_t *p, size_t size) {
     value.resize(size);
@@ -140,18 +424,17 @@ class Value<std::vector<uint8_t>> {
 
   template <typename Stream>
   void WriteToStream(Stream &s) const {
-    uint32_t size_n = utils::HostToNet(value.size());
-    s.write((const char *)&size_n, sizeof(size_n));
+    WriteLength(s, value.size());
     s.write((const char *)value.data(), value.size());
   }
 
   template <typename Stream>
   void ReadFromStream(Stream &s) {
-    uint32_t size;
-    s.read(&size, sizeof(size));
-    size = utils::NetToHost(size);
-    value.resize(size);
-    s.read(value.data(), size);
+    ReadBytes(s, value);
+  }
+
+  size_t GetSerializedSize(Format format = Format::Legacy) const {
+    return GetLengthSize(value.size(), format) + value.size();
   }
 
   std::vector<uint8_t> MakeStreamData() const {
@@ -163,12 +446,275 @@ class Value<std::vector<uint8_t>> {
   }
 };
 
+namespace utils {
+
+/// Element types written as their raw bytes, a whole array at once.
+template <typename T>
+struct IsRawBytes
+    : std::integral_constant<bool,
+                             std::is_integral<T>::value && sizeof(T) == 1> {};
+
+/// Stream doing nothing, used to detect Serialize methods.
+struct NullStream {
+  NullStream &write(const char *, size_t) { return *this; }
+  NullStream &read(char *, size_t) { return *this; }
+  bool good() const { return true; }
+};
+
+/// True if T has the `Serialize(Stream &) const` method of records.
+template <typename T>
+class HasSerialize {
+  template <typename U>
+  static auto Test(int) -> decltype(
+      std::declval<const U &>().Serialize(std::declval<NullStream &>()),
+      std::true_type());
+
+  template <typename U>
+  static std::false_type Test(long);
+
+ public:
+  static const bool value = decltype(Test<T>(0))::value;
+};
+
+/**
+ * Write, read and measure arrays of T.
+ *
+ * The generic version goes through Value<T> element by element. CHUNK is
+ * the number of elements ReadVector() grows a vector by between reads, so
+ * an untrusted length never allocates much more than the stream holds.
+ */
+template <typename T, typename Enable = void>
+struct ArrayCodec {
+  static const size_t CHUNK = 1;
+  static const size_t MIN_SIZE = 1;
+
+  template <typename Stream>
+  static void Write(Stream &s, const T *p, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      Value<T>(p[i]).WriteToStream(s);
+    }
+  }
+
+  template <typename Stream>
+  static void Read(Stream &s, T *p, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      Value<T> value;
+      value.ReadFromStream(s);
+      p[i] = std::move(value.value);
+    }
+  }
+
+  static size_t GetSize(const T *p, size_t n, Format format) {
+    size_t size = 0;
+    for (size_t i = 0; i < n; ++i) {
+      size += Value<T>(p[i]).GetSerializedSize(format);
+    }
+    return size;
+  }
+};
+
+/// Raw bytes, one write or read for the whole array.
+template <typename T>
+struct ArrayCodec<T, typename std::enable_if<IsRawBytes<T>::value>::type> {
+  static const size_t CHUNK = 65536 / sizeof(T);
+  static const size_t MIN_SIZE = sizeof(T);
+
+  template <typename Stream>
+  static void Write(Stream &s, const T *p, size_t n) {
+    s.write((const char *)p, n * sizeof(T));
+  }
+
+  template <typename Stream>
+  static void Read(Stream &s, T *p, size_t n) {
+    s.read((char *)p, n * sizeof(T));
+  }
+
+  static size_t GetSize(const T *, size_t n, Format) { return n * sizeof(T); }
+};
+
+/// Fixed-width integers, byte-swapped through a stack buffer on write and
+/// in place after a single read.
+template <typename T>
+struct ArrayCodec<T, typename std::enable_if<std::is_integral<T>::value &&
+                                             !IsRawBytes<T>::value>::type> {
+  static const size_t CHUNK = 65536 / sizeof(T);
+  static const size_t MIN_SIZE = sizeof(T);
+
+  template <typename Stream>
+  static void Write(Stream &s, const T *p, size_t n) {
+    const size_t BATCH = 256;
+    T buf[BATCH];
+    for (size_t i = 0; i < n; i += BATCH) {
+      size_t k = n - i < BATCH ? n - i : BATCH;
+      for (size_t j = 0; j < k; ++j) {
+        buf[j] = HostToNet(p[i + j]);
+      }
+      s.write((const char *)buf, k * sizeof(T));
+    }
+  }
+
+  template <typename Stream>
+  static void Read(Stream &s, T *p, size_t n) {
+    s.read((char *)p, n * sizeof(T));
+    for (size_t i = 0; i < n; ++i) {
+      p[i] = NetToHost(p[i]);
+    }
+  }
+
+  static size_t GetSize(const T *, size_t n, Format) { return n * sizeof(T); }
+};
+
+/// Records with Serialize, Unserialize and GetSerializedSize methods.
+template <typename T>
+struct ArrayCodec<T, typename std::enable_if<HasSerialize<T>::value>::type> {
+  static const size_t CHUNK = 1;
+  static const size_t MIN_SIZE = 1;
+
+  template <typename Stream>
+  static void Write(Stream &s, const T *p, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      p[i].Serialize(s);
+    }
+  }
+
+  template <typename Stream>
+  static void Read(Stream &s, T *p, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      p[i].Unserialize(s);
+    }
+  }
+
+  static size_t GetSize(const T *p, size_t n, Format format) {
+    size_t size = 0;
+    for (size_t i = 0; i < n; ++i) {
+      size += p[i].GetSerializedSize(format);
+    }
+    return size;
+  }
+};
+
+}  // namespace utils
+
+/// Write a length-prefixed vector, without copying it into a Value.
+template <typename Stream, typename T, typename Alloc>
+void WriteVector(Stream &s, const std::vector<T, Alloc> &values) {
+  WriteLength(s, values.size());
+  utils::ArrayCodec<T>::Write(s, values.data(), values.size());
+}
+
+/**
+ * Read a vector written by WriteVector().
+ *
+ * The vector is reserved once, up to what the stream has left, and grown
+ * while the stream stays good.
+ *
+ * @param s Stream.
+ * @param values Receives the elements.
+ * @param min_size Smallest serialized size of an element.
+ */
+template <typename Stream, typename T, typename Alloc>
+void ReadVector(Stream &s, std::vector<T, Alloc> &values,
+                size_t min_size = utils::ArrayCodec<T>::MIN_SIZE) {
+  typedef utils::ArrayCodec<T> Codec;
+  uint32_t n = ReadLength(s);
+  values.clear();
+  values.reserve(GetReserveCount(s, n, min_size));
+  size_t done = 0;
+  while (done < n && s.good()) {
+    size_t k = n - done < Codec::CHUNK ? n - done : Codec::CHUNK;
+    values.resize(done + k);
+    Codec::Read(s, values.data() + done, k);
+    done += k;
+  }
+}
+
+/// Number of bytes WriteVector() writes.
+template <typename T, typename Alloc>
+size_t GetVectorSize(const std::vector<T, Alloc> &values, Format format) {
+  return GetLengthSize(values.size(), format) +
+         utils::ArrayCodec<T>::GetSize(values.data(), values.size(), format);
+}
+
+template <typename T, typename Alloc>
+class Value<std::vector<T, Alloc>> {
+ public:
+  std::vector<T, Alloc> value;
+
+ public:
+  Value() {}
+  Value(const std::vector<T, Alloc> &another) : value(another) {}
+
+  template <typename Stream>
+  void WriteToStream(Stream &s) const {
+    WriteVector(s, value);
+  }
+
+  template <typename Stream>
+  void ReadFromStream(Stream &s) {
+    ReadVector(s, value);
+  }
+
+  size_t GetSerializedSize(Format format = Format::Legacy) const {
+    return GetVectorSize(value, format);
+  }
+};
+
+/// Fixed-size array, written without a length.
+template <typename T, size_t N>
+class Value<std::array<T, N>> {
+ public:
+  std::array<T, N> value{};
+
+ public:
+  Value() {}
+  Value(const std::array<T, N> &another) : value(another) {}
+
+  template <typename Stream>
+  void WriteToStream(Stream &s) const {
+    utils::ArrayCodec<T>::Write(s, value.data(), N);
+  }
+
+  template <typename Stream>
+  void ReadFromStream(Stream &s) {
+    utils::ArrayCodec<T>::Read(s, value.data(), N);
+  }
+
+  size_t GetSerializedSize(Format format = Format::Legacy) const {
+    return utils::ArrayCodec<T>::GetSize(value.data(), N, format);
+  }
+};
+
+/// Record with Serialize and Unserialize methods, e.g. a Transaction.
+template <typename T>
+class Value<T, typename std::enable_if<utils::HasSerialize<T>::value>::type> {
+ public:
+  T value;
+
+ public:
+  Value() {}
+  Value(const T &another) : value(another) {}
+
+  template <typename Stream>
+  void WriteToStream(Stream &s) const {
+    value.Serialize(s);
+  }
+
+  template <typename Stream>
+  void ReadFromStream(Stream &s) {
+    value.Unserialize(s);
+  }
+
+  size_t GetSerializedSize(Format format = Format::Legacy) const {
+    return value.GetSerializedSize(format);
+  }
+};
+
 template <typename T>
 Value<T> MakeValue(const T &value) {
   return Value<T>(value);
 }
 
-template <typename Stream, typename T>
+template <typename T, typename Stream>
 T ReadValue(Stream &s) {
   Value<T> value;
   value.ReadFromStream(s);
@@ -177,6 +723,13 @@ T ReadValue(Stream &s) {
 
 typedef Value<std::vector<uint8_t>> Buffer;
 
+/// Byte vector, string and buffer with storage from an Arena, or from the
+/// heap without one.
+typedef std::vector<uint8_t, ArenaAllocator<uint8_t>> ArenaBytes;
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>
+    ArenaString;
+typedef Value<ArenaBytes> ArenaBuffer;
+
 }  // namespace data
 }  // namespace coin
 
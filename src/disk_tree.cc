@@ -0,0 +1,134 @@
+#include "disk_tree.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace coin {
+namespace mt {
+
+static const char DISK_TREE_MAGIC[8] = {'C', 'O', 'I', 'N', 'M', 'T', 0, 0};
+static const uint32_t DISK_TREE_VERSION = 1;
+
+/// Parent nodes hashed in one HashNodes() call while building.
+static const size_t BUILD_BATCH = 4096;
+
+static uint64_t RoundUp(uint64_t size, uint64_t page_size) {
+  return (size + page_size - 1) / page_size * page_size;
+}
+
+bool DiskTree::Create(const std::string &path, size_t n,
+                      const LeafFunc &hash_leaf, NodeHashMode mode) {
+  Close();
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, DISK_TREE_MAGIC, sizeof(header.magic));
+  header.version = DISK_TREE_VERSION;
+  header.hash_mode = static_cast<uint32_t>(mode);
+  uint64_t page_size = sysconf(_SC_PAGESIZE);
+  uint64_t offset = RoundUp(sizeof(Header), page_size);
+  for (uint64_t size = n; size > 0; size = (size + 1) / 2) {
+    header.level_offsets[header.level_count] = offset;
+    header.level_sizes[header.level_count] = size;
+    ++header.level_count;
+    offset = RoundUp(offset + size * HASH_SIZE, page_size);
+    if (size == 1) break;
+  }
+  if (!file_.Create(path, offset)) return false;
+  memcpy(file_.get_mutable_data(), &header, sizeof(header));
+  header_ = reinterpret_cast<const Header *>(file_.get_data());
+
+  for (size_t i = 0; i < n; ++i) hash_leaf(i, MutableHash(0, i));
+  for (size_t level = 1; level < level_count(); ++level) {
+    size_t children = level_size(level - 1), pairs = children / 2;
+    for (size_t begin = 0; begin < pairs; begin += BUILD_BATCH) {
+      HashNodes(GetHash(level - 1, begin * 2),
+                std::min(BUILD_BATCH, pairs - begin),
+                MutableHash(level, begin), mode);
+    }
+    if (children % 2 == 1) UpdateNode(level, pairs);
+  }
+  return true;
+}
+
+bool DiskTree::Create(const std::string &path, const uint8_t *leaves,
+                      size_t n, NodeHashMode mode) {
+  return Create(path, n,
+                [leaves](size_t index, uint8_t *out) {
+                  memcpy(out, leaves + index * HASH_SIZE, HASH_SIZE);
+                },
+                mode);
+}
+
+bool DiskTree::Open(const std::string &path, bool writable) {
+  Close();
+  if (!file_.Open(path, writable)) return false;
+  // Proofs and updates touch one page per level.
+  file_.AdviseRandom();
+  if (file_.get_size() < sizeof(Header) || !IsValidHeader()) {
+    file_.Close();
+    return false;
+  }
+  header_ = reinterpret_cast<const Header *>(file_.get_data());
+  return true;
+}
+
+bool DiskTree::IsValidHeader() const {
+  const Header *header = reinterpret_cast<const Header *>(file_.get_data());
+  if (memcmp(header->magic, DISK_TREE_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != DISK_TREE_VERSION ||
+      (header->hash_mode != static_cast<uint32_t>(NodeHashMode::Builder) &&
+       header->hash_mode != static_cast<uint32_t>(NodeHashMode::Hash64)) ||
+      header->level_count > MAX_LEVELS) {
+    return false;
+  }
+  for (size_t level = 0; level < header->level_count; ++level) {
+    uint64_t size = header->level_sizes[level];
+    uint64_t offset = header->level_offsets[level];
+    if (size == 0 || offset > file_.get_size() ||
+        size > (file_.get_size() - offset) / HASH_SIZE) {
+      return false;
+    }
+    if (level > 0 && size != (header->level_sizes[level - 1] + 1) / 2) {
+      return false;
+    }
+  }
+  return header->level_count == 0 ||
+         header->level_sizes[header->level_count - 1] == 1;
+}
+
+void DiskTree::Close() {
+  header_ = nullptr;
+  file_.Close();
+}
+
+data::Buffer DiskTree::Root() const {
+  data::Buffer root;
+  if (level_count() > 0) root.CopyFrom(GetRoot(), HASH_SIZE);
+  return root;
+}
+
+bool DiskTree::Update(size_t index, const uint8_t *leaf) {
+  if (!file_.is_writable() || level_count() == 0 || index >= level_size(0)) {
+    return false;
+  }
+  memcpy(MutableHash(0, index), leaf, HASH_SIZE);
+  for (size_t level = 1; level < level_count(); ++level) {
+    index /= 2;
+    UpdateNode(level, index);
+  }
+  return true;
+}
+
+void DiskTree::UpdateNode(size_t level, size_t index) {
+  const uint8_t *left = GetHash(level - 1, index * 2);
+  if (index * 2 + 1 < level_size(level - 1)) {
+    HashNode(left, left + HASH_SIZE, MutableHash(level, index),
+             get_node_hash_mode());
+  } else {
+    memcpy(MutableHash(level, index), left, HASH_SIZE);
+  }
+}
+
+}  // namespace mt
+}  // namespace coin
@@ -0,0 +1,139 @@
+#ifndef __DISK_TREE_H__
+#define __DISK_TREE_H__
+
+#include <cstdint>
+
+#include <functional>
+#include <string>
+
+#include "data_value.h"
+#include "mapped_file.h"
+#include "merkle_tree.h"
+
+namespace coin {
+namespace mt {
+
+/**
+ * Merkle tree kept in a memory mapped file, for trees larger than memory.
+ *
+ * The file starts with a header page, then holds each level from the leaves
+ * up, every level starting on a page boundary. Only the pages touched are
+ * read: a proof reads one page per level, a leaf update rewrites one page
+ * per level. The root is the same as MakeMerkleTree() over the same leaves.
+ *
+ * The header is in host byte order, a file is meant for the machine which
+ * built it. It records the node hash mode the tree was created with, an
+ * opened tree keeps hashing with that mode.
+ */
+class DiskTree {
+ public:
+  /// Write hash value of leaf `index` to `out`, HASH_SIZE bytes.
+  typedef std::function<void(size_t index, uint8_t *out)> LeafFunc;
+
+  /**
+   * Create the tree file and build the tree, the file stays open writable.
+   *
+   * @param path File path, an existing file is replaced.
+   * @param n Number of leaves.
+   * @param hash_leaf Called once for each leaf, in order.
+   * @param mode How parent nodes are hashed.
+   *
+   * @return False if the file cannot be created.
+   */
+  bool Create(const std::string &path, size_t n, const LeafFunc &hash_leaf,
+              NodeHashMode mode = NodeHashMode::Builder);
+
+  /// Create from `n` consecutive leaf hash values.
+  bool Create(const std::string &path, const uint8_t *leaves, size_t n,
+              NodeHashMode mode = NodeHashMode::Builder);
+
+  /**
+   * Open an existing tree file.
+   *
+   * @param path File path.
+   * @param writable Allow Update().
+   *
+   * @return False if the file is missing or invalid.
+   */
+  bool Open(const std::string &path, bool writable = false);
+
+  /// Write changes to the file.
+  bool Sync() { return file_.Sync(); }
+
+  void Close();
+
+  bool is_open() const { return header_ != nullptr; }
+
+  /// Node hash mode recorded in the file, the default if not open.
+  NodeHashMode get_node_hash_mode() const {
+    return header_ ? static_cast<NodeHashMode>(header_->hash_mode)
+                   : NodeHashMode::Builder;
+  }
+
+  /// Number of levels including the leaves and the root, 0 if empty or not
+  /// open.
+  size_t level_count() const { return header_ ? header_->level_count : 0; }
+
+  /// Number of nodes in a level, level 0 is the leaves.
+  size_t level_size(size_t level) const {
+    assert(level < level_count());
+    return header_->level_sizes[level];
+  }
+
+  /// Hash value of a node, HASH_SIZE bytes.
+  const uint8_t *GetHash(size_t level, size_t index) const {
+    assert(index < level_size(level));
+    return file_.get_data() + header_->level_offsets[level] + index * HASH_SIZE;
+  }
+
+  const uint8_t *GetLeafHash(size_t index) const { return GetHash(0, index); }
+
+  /// Root hash value, HASH_SIZE bytes.
+  const uint8_t *GetRoot() const { return GetHash(level_count() - 1, 0); }
+
+  /// Root hash value, empty if there are no leaves or not open.
+  data::Buffer Root() const;
+
+  /**
+   * Change the hash value of a leaf and rehash its path to the root.
+   *
+   * @param index Leaf index.
+   * @param leaf New hash value, HASH_SIZE bytes.
+   *
+   * @return False if the tree is not writable or the leaf does not exist.
+   */
+  bool Update(size_t index, const uint8_t *leaf);
+
+ private:
+  /// Enough levels for 2^64 leaves.
+  static const size_t MAX_LEVELS = 65;
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t hash_mode;
+    uint64_t level_count;
+    uint64_t level_offsets[MAX_LEVELS];
+    uint64_t level_sizes[MAX_LEVELS];
+  };
+
+  uint8_t *MutableHash(size_t level, size_t index) {
+    return file_.get_mutable_data() + header_->level_offsets[level] +
+           index * HASH_SIZE;
+  }
+
+  /// Hash node `index` of `level` from its children.
+  void UpdateNode(size_t level, size_t index);
+
+  /// Check the header and the level layout of the mapped file.
+  bool IsValidHeader() const;
+
+ private:
+  MappedFile file_;
+  const Header *header_ = nullptr;
+};
+
+}  // namespace mt
+}  // namespace coin
+
+#endif
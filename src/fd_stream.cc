@@ -0,0 +1,94 @@
+#include "fd_stream.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace coin {
+
+const size_t FdStream::BUFFER_SIZE;
+
+FdStream &FdStream::write(const char *p, size_t size) {
+  if (fail_) return *this;
+  if (write_size_ + size > BUFFER_SIZE) {
+    Flush();
+    if (size >= BUFFER_SIZE) {
+      WriteAll(p, size);
+      return *this;
+    }
+  }
+  memcpy(write_buf_ + write_size_, p, size);
+  write_size_ += size;
+  return *this;
+}
+
+FdStream &FdStream::read(char *p, size_t size) {
+  if (write_size_ > 0) Flush();
+  while (!fail_ && size > 0) {
+    if (read_begin_ == read_end_) {
+      if (size >= BUFFER_SIZE) {
+        size_t n = ReadSome(p, size);
+        p += n;
+        size -= n;
+        continue;
+      }
+      read_begin_ = 0;
+      read_end_ = ReadSome(read_buf_, BUFFER_SIZE);
+      continue;
+    }
+    size_t n = std::min(size, read_end_ - read_begin_);
+    memcpy(p, read_buf_ + read_begin_, n);
+    read_begin_ += n;
+    p += n;
+    size -= n;
+  }
+  return *this;
+}
+
+bool FdStream::Flush() {
+  WriteAll(write_buf_, write_size_);
+  write_size_ = 0;
+  return !fail_;
+}
+
+void FdStream::WriteAll(const char *p, size_t size) {
+  while (!fail_ && size > 0) {
+    ssize_t n;
+    if (socket_) {
+      n = send(fd_, p, size, MSG_NOSIGNAL);
+      if (n < 0 && errno == ENOTSOCK) {
+        socket_ = false;
+        continue;
+      }
+    } else {
+      n = ::write(fd_, p, size);
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      fail_ = true;
+      break;
+    }
+    p += n;
+    size -= n;
+    bytes_written_ += n;
+  }
+}
+
+size_t FdStream::ReadSome(char *p, size_t size) {
+  while (!fail_) {
+    ssize_t n = ::read(fd_, p, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      fail_ = true;
+      break;
+    }
+    bytes_read_ += n;
+    return n;
+  }
+  return 0;
+}
+
+}  // namespace coin
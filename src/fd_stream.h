@@ -0,0 +1,71 @@
+#ifndef __FD_STREAM_H__
+#define __FD_STREAM_H__
+
+#include <cstddef>
+#include <cstdint>
+
+namespace coin {
+
+/**
+ * Blocking, buffered stream over a file descriptor, e.g. a socket or pipe.
+ *
+ * Satisfies the `Stream` concept of `data::Value<T>::WriteToStream` and the
+ * `Serialize` methods. Small writes are collected until Flush(), the next
+ * read or destruction, so each protocol turn goes out in one send(). Reads
+ * take whatever the descriptor has ready up to the buffer size. A failed or
+ * short read or write sets the fail flag, later calls do nothing then.
+ * Writes to a socket whose peer has closed fail with EPIPE instead of
+ * raising SIGPIPE, a pipe still raises it.
+ */
+class FdStream {
+ public:
+  /// Size of the read and the write buffer.
+  static const size_t BUFFER_SIZE = 4096;
+
+  explicit FdStream(int fd) : fd_(fd) {}
+  ~FdStream() { Flush(); }
+
+  FdStream(const FdStream &) = delete;
+  FdStream &operator=(const FdStream &) = delete;
+
+  FdStream &write(const char *p, size_t size);
+
+  /// Flushes pending writes first, the peer may wait for them.
+  FdStream &read(char *p, size_t size);
+
+  /**
+   * Send pending writes.
+   *
+   * @return False if the stream failed.
+   */
+  bool Flush();
+
+  /// True if no read or write failed.
+  bool good() const { return !fail_; }
+
+  /// Bytes sent to and received from the descriptor.
+  uint64_t get_bytes_written() const { return bytes_written_; }
+  uint64_t get_bytes_read() const { return bytes_read_; }
+
+ private:
+  /// Write all bytes to the descriptor.
+  void WriteAll(const char *p, size_t size);
+
+  /// Read at most `size` bytes from the descriptor, at least one.
+  size_t ReadSome(char *p, size_t size);
+
+  int fd_;
+  bool socket_ = true;  // Cleared once send() reports ENOTSOCK.
+  bool fail_ = false;
+  uint64_t bytes_written_ = 0;
+  uint64_t bytes_read_ = 0;
+  char write_buf_[BUFFER_SIZE];
+  size_t write_size_ = 0;
+  char read_buf_[BUFFER_SIZE];
+  size_t read_begin_ = 0;
+  size_t read_end_ = 0;
+};
+
+}  // namespace coin
+
+#endif
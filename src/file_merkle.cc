@@ -0,0 +1,71 @@
+#include "file_merkle.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "flat_tree.h"
+#include "mapped_file.h"
+#include "merkle_accumulator.h"
+
+namespace coin {
+namespace mt {
+
+void HashChunk(const uint8_t *p, size_t size, uint8_t *out) {
+  uint32_t size_n = data::utils::HostToNet<uint32_t>(size);
+  Hash256 algo;
+  algo.Calculate(reinterpret_cast<const uint8_t *>(&size_n), sizeof(size_n));
+  algo.Calculate(p, size);
+  algo.Final();
+  memcpy(out, algo.get_md(), HASH_SIZE);
+}
+
+data::Buffer HashChunks(const uint8_t *p, uint64_t size, size_t chunk_size,
+                        ThreadPool &pool) {
+  assert(chunk_size > 0 && chunk_size <= UINT32_MAX);
+  size_t n = (size + chunk_size - 1) / chunk_size;
+  FlatTree tree;
+  // Chunks are large, every level with two nodes or more is worth splitting.
+  tree.BuildParallel(n,
+                     [p, size, chunk_size](size_t index, uint8_t *out) {
+                       uint64_t offset =
+                           static_cast<uint64_t>(index) * chunk_size;
+                       HashChunk(p + offset,
+                                 std::min<uint64_t>(chunk_size, size - offset),
+                                 out);
+                     },
+                     pool, 2);
+  return tree.Root();
+}
+
+data::Buffer HashStreamChunks(std::istream &in, size_t chunk_size) {
+  assert(chunk_size > 0 && chunk_size <= UINT32_MAX);
+  std::vector<char> chunk(chunk_size);
+  RootAccumulator accumulator;
+  uint8_t leaf[HASH_SIZE];
+  while (in) {
+    in.read(chunk.data(), chunk_size);
+    size_t size = in.gcount();
+    if (size == 0) break;
+    HashChunk(reinterpret_cast<const uint8_t *>(chunk.data()), size, leaf);
+    accumulator.Push(leaf);
+  }
+  return accumulator.Root();
+}
+
+bool HashFile(const std::string &path, size_t chunk_size, ThreadPool &pool,
+              FileHashResult &result) {
+  MappedFile file;
+  if (!file.Open(path)) return false;
+  // Each thread walks its part of the file front to back.
+  file.AdviseSequential();
+  auto begin = std::chrono::steady_clock::now();
+  result.root = HashChunks(file.get_data(), file.get_size(), chunk_size, pool);
+  auto end = std::chrono::steady_clock::now();
+  result.file_size = file.get_size();
+  result.num_chunks = (result.file_size + chunk_size - 1) / chunk_size;
+  result.seconds = std::chrono::duration<double>(end - begin).count();
+  return true;
+}
+
+}  // namespace mt
+}  // namespace coin
@@ -0,0 +1,93 @@
+#ifndef __FILE_MERKLE_H__
+#define __FILE_MERKLE_H__
+
+#include <cstdint>
+
+#include <istream>
+#include <string>
+
+#include "data_value.h"
+#include "thread_pool.h"
+
+namespace coin {
+namespace mt {
+
+/// Default size of file chunks.
+const size_t DEFAULT_CHUNK_SIZE = 1024 * 1024;
+
+/// Result of HashFile().
+struct FileHashResult {
+  /// Merkle root, empty for an empty file.
+  data::Buffer root;
+  uint64_t file_size = 0;
+  size_t num_chunks = 0;
+  /// Time spent hashing, the file is mapped and read on demand.
+  double seconds = 0;
+
+  /// Throughput in GB/s (10^9 bytes).
+  double GetGBPerSec() const {
+    return seconds > 0 ? file_size / seconds / 1e9 : 0;
+  }
+};
+
+/**
+ * Hash value of a leaf chunk.
+ *
+ * The same value as a leaf whose CalcHash() returns
+ * `Hash256Builder << data::MakeValue(chunk)`, without copying the chunk.
+ *
+ * @param p Chunk data.
+ * @param size Chunk size.
+ * @param out HASH_SIZE bytes output.
+ */
+void HashChunk(const uint8_t *p, size_t size, uint8_t *out);
+
+/**
+ * Merkle root of memory cut into fixed-size chunks.
+ *
+ * Chunks and tree levels are hashed on the pool, see FlatTree. The
+ * last chunk is shorter if size is not a multiple of chunk_size. The root is
+ * the same as MakeMerkleTree() over the chunks.
+ *
+ * @param p Data.
+ * @param size Size of data.
+ * @param chunk_size Size of each chunk, at most 4 GB.
+ * @param pool Threads to use.
+ *
+ * @return Root hash value, empty if size is 0.
+ */
+data::Buffer HashChunks(const uint8_t *p, uint64_t size, size_t chunk_size,
+                        ThreadPool &pool);
+
+/**
+ * Merkle root of a stream cut into chunks, see HashChunks().
+ *
+ * Chunks are hashed while the stream is read, e.g. from a pipe or socket.
+ * Only one chunk and one pending hash value per tree level are kept.
+ *
+ * @param in Input stream, read to its end.
+ * @param chunk_size Size of each chunk.
+ *
+ * @return Root hash value, empty if the stream is empty.
+ */
+data::Buffer HashStreamChunks(std::istream &in, size_t chunk_size);
+
+/**
+ * Merkle root of a file, see HashChunks().
+ *
+ * The file is memory mapped, chunks are hashed in place.
+ *
+ * @param path File path.
+ * @param chunk_size Size of each chunk.
+ * @param pool Threads to use.
+ * @param result Root, sizes and timing.
+ *
+ * @return False if the file cannot be mapped.
+ */
+bool HashFile(const std::string &path, size_t chunk_size, ThreadPool &pool,
+              FileHashResult &result);
+
+}  // namespace mt
+}  // namespace coin
+
+#endif
@@ -0,0 +1,122 @@
+#include "flat_tree.h"
+
+#include <algorithm>
+#include <new>
+
+namespace coin {
+namespace mt {
+
+/// Alignment of the hash values array, one node per 32-byte load.
+static const size_t HASHES_ALIGNMENT = 32;
+
+/// Pieces per thread, small enough to balance uneven leaf costs.
+static const size_t PIECES_PER_THREAD = 8;
+
+/// Run `fn` over [0, count), in parallel if count reaches cutoff.
+static void ForRange(size_t count, ThreadPool *pool, size_t cutoff,
+                     const ThreadPool::RangeFunc &fn) {
+  if (pool == nullptr || pool->get_num_threads() == 1 || count < cutoff ||
+      count < 2) {
+    fn(0, count);
+    return;
+  }
+  size_t grain = count / (pool->get_num_threads() * PIECES_PER_THREAD);
+  pool->ParallelFor(count, std::max<size_t>(grain, 1), fn);
+}
+
+FlatTree::FlatTree(const FlatTree &another) : mode_(another.mode_) {
+  *this = another;
+}
+
+FlatTree &FlatTree::operator=(const FlatTree &another) {
+  if (this != &another) {
+    mode_ = another.mode_;
+    if (another.empty()) {
+      Clear();
+    } else {
+      Allocate(another.leaf_count());
+      memcpy(hashes_.get(), another.hashes_.get(), get_memory_size());
+    }
+  }
+  return *this;
+}
+
+FlatTree::FlatTree(FlatTree &&another) : mode_(another.mode_) {
+  *this = std::move(another);
+}
+
+FlatTree &FlatTree::operator=(FlatTree &&another) {
+  if (this != &another) {
+    mode_ = another.mode_;
+    hashes_ = std::move(another.hashes_);
+    node_count_ = another.node_count_;
+    level_offsets_ = std::move(another.level_offsets_);
+    level_sizes_ = std::move(another.level_sizes_);
+    another.Clear();
+  }
+  return *this;
+}
+
+void FlatTree::Build(const uint8_t *leaves, size_t n) {
+  Allocate(n);
+  if (n == 0) return;
+  memcpy(MutableHash(0, 0), leaves, n * HASH_SIZE);
+  HashLevels(nullptr, 0);
+}
+
+void FlatTree::BuildParallel(size_t n, const LeafFunc &hash_leaf,
+                             ThreadPool &pool, size_t cutoff) {
+  Allocate(n);
+  if (n == 0) return;
+  ForRange(n, &pool, cutoff, [this, &hash_leaf](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) hash_leaf(i, MutableHash(0, i));
+  });
+  HashLevels(&pool, cutoff);
+}
+
+void FlatTree::Clear() {
+  hashes_.reset();
+  node_count_ = 0;
+  level_offsets_.clear();
+  level_sizes_.clear();
+}
+
+data::Buffer FlatTree::Root() const {
+  data::Buffer root;
+  if (!empty()) root.CopyFrom(GetRoot(), HASH_SIZE);
+  return root;
+}
+
+void FlatTree::Allocate(size_t n) {
+  Clear();
+  if (n == 0) return;
+  size_t size = n;
+  while (true) {
+    level_offsets_.push_back(node_count_);
+    level_sizes_.push_back(size);
+    node_count_ += size;
+    if (size == 1) break;
+    size = (size + 1) / 2;
+  }
+  void *p = nullptr;
+  if (posix_memalign(&p, HASHES_ALIGNMENT, node_count_ * HASH_SIZE) != 0) {
+    throw std::bad_alloc();
+  }
+  hashes_.reset(static_cast<uint8_t *>(p));
+}
+
+void FlatTree::HashLevels(ThreadPool *pool, size_t cutoff) {
+  for (size_t level = 0; level + 1 < level_count(); ++level) {
+    size_t n = level_sizes_[level], pairs = n / 2;
+    ForRange(pairs, pool, cutoff, [this, level](size_t begin, size_t end) {
+      HashNodes(GetHash(level, begin * 2), end - begin,
+                MutableHash(level + 1, begin), mode_);
+    });
+    if (n % 2 == 1) {
+      memcpy(MutableHash(level + 1, pairs), GetHash(level, n - 1), HASH_SIZE);
+    }
+  }
+}
+
+}  // namespace mt
+}  // namespace coin
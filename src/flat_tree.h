@@ -0,0 +1,189 @@
+#ifndef __FLAT_TREE_H__
+#define __FLAT_TREE_H__
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "data_value.h"
+#include "merkle_tree.h"
+#include "thread_pool.h"
+
+namespace coin {
+namespace mt {
+
+/// Levels narrower than this are hashed on the calling thread only.
+const size_t DEFAULT_PARALLEL_CUTOFF = 1024;
+
+/**
+ * Merkle tree stored as hash values only, level by level.
+ *
+ * All hash values live in one 32-byte aligned array: the leaves first, then
+ * each parent level up to the root. Leaves are referenced by index into the
+ * container the tree was built from, values are not copied. An odd node at
+ * the end of a level is promoted, it appears again as the last node of the
+ * next level. The root is the same as MakeMerkleTree() over the same leaves
+ * and node hash mode.
+ */
+class FlatTree {
+ public:
+  /// Write hash value of leaf `index` to `out`, HASH_SIZE bytes.
+  typedef std::function<void(size_t index, uint8_t *out)> LeafFunc;
+
+ public:
+  /// Create an empty tree hashing parent nodes with `mode`.
+  explicit FlatTree(NodeHashMode mode = NodeHashMode::Builder)
+      : mode_(mode) {}
+
+  FlatTree(const FlatTree &another);
+  FlatTree &operator=(const FlatTree &another);
+
+  FlatTree(FlatTree &&another);
+  FlatTree &operator=(FlatTree &&another);
+
+  /**
+   * Build tree from leaf hash values.
+   *
+   * @param leaves `n` consecutive leaf hash values, HASH_SIZE bytes each.
+   * @param n Number of leaves.
+   */
+  void Build(const uint8_t *leaves, size_t n);
+
+  /**
+   * Build tree from a container, leaf `i` is `container[i].CalcHash()`.
+   *
+   * @param container Leaf values.
+   */
+  template <typename Container>
+  void BuildFrom(const Container &container) {
+    Allocate(container.size());
+    size_t i = 0;
+    for (const typename Container::value_type &val : container) {
+      data::Buffer hash = val.CalcHash();
+      assert(hash.value.size() == HASH_SIZE);
+      memcpy(MutableHash(0, i++), hash.value.data(), HASH_SIZE);
+    }
+    HashLevels(nullptr, 0);
+  }
+
+  /**
+   * Build tree on a thread pool.
+   *
+   * Leaves are hashed in parallel, so is every level with at least `cutoff`
+   * nodes. The tree is the same as a serial build.
+   *
+   * @param n Number of leaves.
+   * @param hash_leaf Called once for each leaf, from any thread.
+   * @param pool Threads to use.
+   * @param cutoff Minimal number of nodes of a level hashed in parallel.
+   */
+  void BuildParallel(size_t n, const LeafFunc &hash_leaf, ThreadPool &pool,
+                     size_t cutoff = DEFAULT_PARALLEL_CUTOFF);
+
+  /**
+   * Build tree from a random access container on a thread pool.
+   *
+   * @param container Leaf values, CalcHash() is called from any thread.
+   * @param pool Threads to use.
+   * @param cutoff Minimal number of nodes of a level hashed in parallel.
+   */
+  template <typename Container>
+  void BuildFrom(const Container &container, ThreadPool &pool,
+                 size_t cutoff = DEFAULT_PARALLEL_CUTOFF) {
+    BuildParallel(container.size(),
+                  [&container](size_t index, uint8_t *out) {
+                    data::Buffer hash = container[index].CalcHash();
+                    assert(hash.value.size() == HASH_SIZE);
+                    memcpy(out, hash.value.data(), HASH_SIZE);
+                  },
+                  pool, cutoff);
+  }
+
+  /// Remove all nodes, the node hash mode is kept.
+  void Clear();
+
+  NodeHashMode get_node_hash_mode() const { return mode_; }
+
+  bool empty() const { return level_sizes_.empty(); }
+
+  /// Number of levels including the leaves and the root, 0 if empty.
+  size_t level_count() const { return level_sizes_.size(); }
+
+  /// Number of nodes in a level, level 0 is the leaves.
+  size_t level_size(size_t level) const { return level_sizes_[level]; }
+
+  size_t leaf_count() const { return empty() ? 0 : level_sizes_[0]; }
+
+  /// Hash value of a node, HASH_SIZE bytes.
+  const uint8_t *GetHash(size_t level, size_t index) const {
+    assert(level < level_count() && index < level_sizes_[level]);
+    return hashes_.get() + (level_offsets_[level] + index) * HASH_SIZE;
+  }
+
+  /// Hash value of a leaf.
+  const uint8_t *GetLeafHash(size_t index) const { return GetHash(0, index); }
+
+  /// Root hash value, HASH_SIZE bytes.
+  const uint8_t *GetRoot() const { return GetHash(level_count() - 1, 0); }
+
+  /// Root hash value, empty if there are no leaves.
+  data::Buffer Root() const;
+
+  /// Bytes used by the hash values array.
+  size_t get_memory_size() const { return node_count_ * HASH_SIZE; }
+
+ private:
+  struct FreeDeleter {
+    void operator()(uint8_t *p) const { free(p); }
+  };
+
+  /// Layout levels for `n` leaves and allocate the array.
+  void Allocate(size_t n);
+
+  /**
+   * Hash all parent levels from the leaves.
+   *
+   * @param pool Threads to use, nullptr to hash on the calling thread.
+   * @param cutoff Minimal number of nodes of a level hashed in parallel.
+   */
+  void HashLevels(ThreadPool *pool, size_t cutoff);
+
+  uint8_t *MutableHash(size_t level, size_t index) {
+    return hashes_.get() + (level_offsets_[level] + index) * HASH_SIZE;
+  }
+
+ private:
+  NodeHashMode mode_;
+  std::unique_ptr<uint8_t, FreeDeleter> hashes_;
+  size_t node_count_ = 0;
+  std::vector<size_t> level_offsets_;
+  std::vector<size_t> level_sizes_;
+};
+
+/**
+ * Merkle root of a random access container, built on a thread pool.
+ *
+ * @param container Leaf values.
+ * @param pool Threads to use.
+ * @param cutoff Minimal number of nodes of a level hashed in parallel.
+ * @param mode How parent nodes are hashed.
+ *
+ * @return The same root as MakeMerkleTree(container, mode), empty if there
+ * are no leaves.
+ */
+template <typename Container>
+data::Buffer MakeMerkleRoot(const Container &container, ThreadPool &pool,
+                            size_t cutoff = DEFAULT_PARALLEL_CUTOFF,
+                            NodeHashMode mode = NodeHashMode::Builder) {
+  FlatTree tree(mode);
+  tree.BuildFrom(container, pool, cutoff);
+  return tree.Root();
+}
+
+}  // namespace mt
+}  // namespace coin
+
+#endif
@@ -2,56 +2,66 @@
 
 #include <arpa/inet.h>
 
+#include <algorithm>
 #include <cassert>
-#include <sstream>
 #include <string>
 
-namespace coin {
+#include "hex.h"
 
-Hash160::Hash160() { assert(RIPEMD160_Init(&ctx_) == 1); }
+namespace coin {
 
-Hash160::~Hash160() {
-  if (!finished_) {
-    Final();
-  }
-}
+Hash160::Hash160() { RIPEMD160_Init(&ctx_); }
 
 void Hash160::Calculate(const uint8_t *p, size_t size) {
-  assert(RIPEMD160_Update(&ctx_, p, size) == 1);
+  RIPEMD160_Update(&ctx_, p, size);
 }
 
-void Hash160::Final() { assert(RIPEMD160_Final(md_, &ctx_) == 1); }
-
-Hash256::Hash256() { SHA256_Init(&ctx_); }
-
-Hash256::~Hash256() {
-  if (!finished_) Final();
+void Hash160::Final() {
+  assert(!finished_);
+  RIPEMD160_Final(md_, &ctx_);
+  finished_ = true;
 }
 
+Hash256::Hash256() { sha256::Init(ctx_); }
+
 void Hash256::Calculate(const uint8_t *p, size_t size) {
-  assert(p != nullptr && size > 0);
-  assert(SHA256_Update(&ctx_, p, size) == 1);
+  if (size == 0) return;
+  assert(p != nullptr);
+  sha256::Update(ctx_, p, size);
 }
 
 void Hash256::Final() {
   assert(!finished_);
-  assert(SHA256_Final(md_, &ctx_) == 1);
+  sha256::Final(ctx_, md_);
   finished_ = true;
 }
 
+void Hash256Batch::Add(const uint8_t *p, size_t size) {
+  data_.push_back(p);
+  sizes_.push_back(size);
+}
+
+void Hash256Batch::Calculate() {
+  mds_.resize(sizes_.size() * sha256::OUTPUT_SIZE);
+  sha256::HashMany(data_.data(), sizes_.data(), sizes_.size(), mds_.data());
+}
+
+void Hash256Batch::Clear() {
+  data_.clear();
+  sizes_.clear();
+  mds_.clear();
+}
+
+data::Buffer Hash256Batch::GetValue(size_t index) const {
+  data::Buffer buffer;
+  buffer.CopyFrom(get_md(index), get_md_size());
+  return buffer;
+}
+
 std::string HashToStr(const data::Buffer &hash, int num_of_digits) {
-  std::stringstream ss;
-  char digits[3];
-  int n = 0;
-  auto it = std::begin(hash.value), end = std::end(hash.value);
-  while (n < num_of_digits && it < end) {
-    sprintf(digits, "%02x", *it);
-    ss << digits;
-    // next
-    ++n;
-    ++it;
-  }
-  return ss.str();
+  size_t size = num_of_digits > 0 ? num_of_digits : 0;
+  size = std::min(size, hash.value.size());
+  return hex::Encode(hash.value.data(), size);
 }
 
 }  // namespace coin
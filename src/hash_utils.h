@@ -1,12 +1,15 @@
 #ifndef __HASH_UTILS_H__
 #define __HASH_UTILS_H__
 
+#include <cassert>
+#include <cstring>
+
 #include <vector>
 
 #include <openssl/ripemd.h>
-#include <openssl/sha.h>
 
 #include "data_value.h"
+#include "sha256.h"
 
 namespace coin {
 
@@ -14,7 +17,6 @@ namespace coin {
 class Hash160 {
  public:
   Hash160();
-  ~Hash160();
 
   void Calculate(const uint8_t *p, size_t size);
   void Final();
@@ -30,35 +32,75 @@ class Hash160 {
   bool finished_ = false;
 };
 
-/// Hash 256 algorithm.
+/**
+ * Hash 256 algorithm.
+ *
+ * Compression runs on the fastest in-tree SHA-256 kernel for this CPU, see
+ * sha256::Transform.
+ *
+ * Hash256 is cheap to copy, a copy continues from the same partially absorbed
+ * state (midstate). Absorb a constant prefix once, then copy or Restore() the
+ * state for each variant of the message.
+ */
 class Hash256 {
  public:
   Hash256();
-  ~Hash256();
 
   void Calculate(const uint8_t *p, size_t size);
   void Final();
 
+  /// Copy of the partially absorbed state.
+  sha256::Context Snapshot() const {
+    assert(!finished_);
+    return ctx_;
+  }
+
+  /// Continue from a state saved by Snapshot().
+  void Restore(const sha256::Context &state) {
+    ctx_ = state;
+    finished_ = false;
+  }
+
   const uint8_t *get_md() const { return md_; }
-  size_t get_md_size() const { return SHA256_DIGEST_LENGTH; }
+  size_t get_md_size() const { return sha256::OUTPUT_SIZE; }
 
   bool is_finished() const { return finished_; }
 
  private:
-  uint8_t md_[SHA256_DIGEST_LENGTH];
-  SHA256_CTX ctx_;
+  uint8_t md_[sha256::OUTPUT_SIZE];
+  sha256::Context ctx_;
   bool finished_ = false;
 };
 
-/// Hash value builder.
+/**
+ * Hash value builder.
+ *
+ * HashBuilder also satisfies the `Stream` concept used by
+ * `data::Value<T>::WriteToStream` and the `Serialize` methods, so values and
+ * whole objects are absorbed into the hash context directly without building
+ * an intermediate buffer.
+ */
 template <typename HashAlgo>
 class HashBuilder {
  public:
+  HashBuilder() {}
+
+  /// Continue from a saved hash state, e.g. a midstate from get_algo().
+  explicit HashBuilder(const HashAlgo &algo) : algo_(algo) {}
+
+  /// Current hash state.
+  const HashAlgo &get_algo() const { return algo_; }
+
   template <typename DataValue>
   HashBuilder &operator<<(const DataValue &value) {
+    value.WriteToStream(*this);
+    return *this;
+  }
+
+  /// Absorb raw bytes, called by `WriteToStream` and `Serialize`.
+  HashBuilder &write(const char *p, size_t size) {
     assert(!algo_.is_finished());
-    auto data = value.MakeStreamData();
-    algo_.Calculate(data.data(), data.size());
+    algo_.Calculate(reinterpret_cast<const uint8_t *>(p), size);
     return *this;
   }
 
@@ -89,6 +131,70 @@ class HashBuilder {
 typedef HashBuilder<Hash160> Hash160Builder;
 typedef HashBuilder<Hash256> Hash256Builder;
 
+/**
+ * Hash many independent messages with Hash256.
+ *
+ * Messages are queued with Add() and hashed together by Calculate(), which
+ * compresses several of them at a time on the multi-lane SHA-256 kernels.
+ * Results are the same as hashing each message with Hash256Builder.
+ */
+class Hash256Batch {
+ public:
+  /// Queue a message, data must stay valid until Calculate() returns.
+  void Add(const uint8_t *p, size_t size);
+
+  /// Queue a message, data must stay valid until Calculate() returns.
+  void Add(const std::vector<uint8_t> &data) { Add(data.data(), data.size()); }
+
+  /// Hash all queued messages.
+  void Calculate();
+
+  /// Remove messages and results, allocated memory is kept for reuse.
+  void Clear();
+
+  /// Number of queued messages.
+  size_t size() const { return sizes_.size(); }
+
+  /// Hash value of message `index`, valid after Calculate().
+  const uint8_t *get_md(size_t index) const {
+    return mds_.data() + index * sha256::OUTPUT_SIZE;
+  }
+
+  size_t get_md_size() const { return sha256::OUTPUT_SIZE; }
+
+  /// Hash value of message `index` as buffer.
+  data::Buffer GetValue(size_t index) const;
+
+ private:
+  std::vector<const uint8_t *> data_;
+  std::vector<size_t> sizes_;
+  std::vector<uint8_t> mds_;
+};
+
+/**
+ * Hash256 of exactly 64 bytes, e.g. two concatenated 32-byte hash values.
+ *
+ * Skips the generic buffering and padding of Hash256, the result is the same
+ * as Hash256Builder::CalculateHash(in, 64).
+ *
+ * @param in 64 bytes input.
+ * @param out 32 bytes output.
+ */
+inline void Hash64To32(const uint8_t *in, uint8_t *out) {
+  sha256::Hash64(in, out, 1);
+}
+
+/**
+ * Multi-lane Hash64To32.
+ *
+ * @param in `n` consecutive 64 bytes inputs.
+ * @param out `n` consecutive 32 bytes outputs.
+ * @param n Number of inputs.
+ */
+inline void Hash64To32(const uint8_t *in, uint8_t *out, size_t n) {
+  sha256::Hash64(in, out, n);
+}
+
 /// Convert DataValue to string.
 std::string HashToStr(const data::Buffer &hash, int num_of_digits = 4);
 
@@ -0,0 +1,223 @@
+#include "hex.h"
+
+#include "sysutils.h"
+
+#ifdef SYSUTILS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace coin {
+namespace hex {
+
+static const char *HEX_DIGITS = "0123456789abcdef";
+
+/// Value of a hex digit, -1 for other characters.
+static int DigitValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static void EncodePortable(const uint8_t *p, size_t size, char *out) {
+  for (size_t i = 0; i < size; ++i) {
+    out[i * 2] = HEX_DIGITS[p[i] >> 4];
+    out[i * 2 + 1] = HEX_DIGITS[p[i] & 0x0f];
+  }
+}
+
+static bool DecodePortable(const char *str, size_t size, uint8_t *out) {
+  for (size_t i = 0; i < size; ++i) {
+    int hi = DigitValue(str[i * 2]);
+    int lo = DigitValue(str[i * 2 + 1]);
+    if (hi < 0 || lo < 0) return false;
+    out[i] = (hi << 4) | lo;
+  }
+  return true;
+}
+
+#ifdef SYSUTILS_X86_KERNELS
+
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+/// Hex characters of 16 bytes, first and second half of output.
+SSSE3_TARGET static inline void EncodeBlock(__m128i data, __m128i &out_lo,
+                                            __m128i &out_hi) {
+  const __m128i DIGITS = _mm_loadu_si128(
+      reinterpret_cast<const __m128i *>(HEX_DIGITS));
+  const __m128i MASK = _mm_set1_epi8(0x0f);
+  __m128i hi = _mm_shuffle_epi8(
+      DIGITS, _mm_and_si128(_mm_srli_epi16(data, 4), MASK));
+  __m128i lo = _mm_shuffle_epi8(DIGITS, _mm_and_si128(data, MASK));
+  out_lo = _mm_unpacklo_epi8(hi, lo);
+  out_hi = _mm_unpackhi_epi8(hi, lo);
+}
+
+SSSE3_TARGET static void EncodeSSSE3(const uint8_t *p, size_t size,
+                                     char *out) {
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i lo, hi;
+    EncodeBlock(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i)), lo,
+                hi);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2), lo);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2 + 16), hi);
+  }
+  EncodePortable(p + i, size - i, out + i * 2);
+}
+
+AVX2_TARGET static void EncodeAVX2(const uint8_t *p, size_t size, char *out) {
+  const __m256i DIGITS = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(HEX_DIGITS)));
+  const __m256i MASK = _mm256_set1_epi8(0x0f);
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i data =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+    __m256i hi = _mm256_shuffle_epi8(
+        DIGITS, _mm256_and_si256(_mm256_srli_epi16(data, 4), MASK));
+    __m256i lo = _mm256_shuffle_epi8(DIGITS, _mm256_and_si256(data, MASK));
+    // Unpack works inside 128-bit lanes, put the lanes back in order.
+    __m256i a = _mm256_unpacklo_epi8(hi, lo);
+    __m256i b = _mm256_unpackhi_epi8(hi, lo);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i * 2),
+                        _mm256_permute2x128_si256(a, b, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i * 2 + 32),
+                        _mm256_permute2x128_si256(a, b, 0x31));
+  }
+  EncodeSSSE3(p + i, size - i, out + i * 2);
+}
+
+/**
+ * Digit values of 16 characters.
+ *
+ * @return Mask of valid digits, 0xffff if all are valid.
+ */
+SSSE3_TARGET static inline int DecodeDigits(__m128i c, __m128i &value) {
+  __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+  __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                   _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+  __m128i is_alpha =
+      _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                    _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+  __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+  __m128i alpha = _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10));
+  value = _mm_or_si128(_mm_and_si128(is_digit, digit),
+                       _mm_andnot_si128(is_digit, alpha));
+  return _mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha));
+}
+
+SSSE3_TARGET static bool DecodeSSSE3(const char *str, size_t size,
+                                     uint8_t *out) {
+  // Each pair of digits is combined to hi * 16 + lo.
+  const __m128i WEIGHTS = _mm_set1_epi16(0x0110);
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i v0, v1;
+    int valid = DecodeDigits(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + i * 2)), v0);
+    valid &= DecodeDigits(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + i * 2 + 16)),
+        v1);
+    if (valid != 0xffff) return false;
+    __m128i bytes = _mm_packus_epi16(_mm_maddubs_epi16(v0, WEIGHTS),
+                                     _mm_maddubs_epi16(v1, WEIGHTS));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), bytes);
+  }
+  return DecodePortable(str + i * 2, size - i, out + i);
+}
+
+AVX2_TARGET static inline uint32_t DecodeDigits(__m256i c, __m256i &value) {
+  __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+  __m256i is_digit =
+      _mm256_andnot_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('9')),
+                          _mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)));
+  __m256i is_alpha =
+      _mm256_andnot_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('f')),
+                          _mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)));
+  __m256i digit = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+  __m256i alpha = _mm256_sub_epi8(lower, _mm256_set1_epi8('a' - 10));
+  value = _mm256_blendv_epi8(alpha, digit, is_digit);
+  return _mm256_movemask_epi8(_mm256_or_si256(is_digit, is_alpha));
+}
+
+AVX2_TARGET static bool DecodeAVX2(const char *str, size_t size,
+                                   uint8_t *out) {
+  const __m256i WEIGHTS = _mm256_set1_epi16(0x0110);
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i v0, v1;
+    uint32_t valid = DecodeDigits(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(str + i * 2)),
+        v0);
+    valid &= DecodeDigits(
+        _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(str + i * 2 + 32)),
+        v1);
+    if (valid != 0xffffffff) return false;
+    // Pack works inside 128-bit lanes, put the lanes back in order.
+    __m256i bytes = _mm256_packus_epi16(_mm256_maddubs_epi16(v0, WEIGHTS),
+                                        _mm256_maddubs_epi16(v1, WEIGHTS));
+    bytes = _mm256_permute4x64_epi64(bytes, 0xd8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), bytes);
+  }
+  return DecodeSSSE3(str + i * 2, size - i, out + i);
+}
+
+#endif
+
+typedef void (*EncodeFunc)(const uint8_t *p, size_t size, char *out);
+typedef bool (*DecodeFunc)(const char *str, size_t size, uint8_t *out);
+
+struct Codec {
+  EncodeFunc encode;
+  DecodeFunc decode;
+};
+
+static Codec SelectCodec() {
+  Codec codec = {EncodePortable, DecodePortable};
+#ifdef SYSUTILS_X86_KERNELS
+  const sysutils::CpuFeatures &features = sysutils::GetCpuFeatures();
+  if (features.avx2) {
+    codec.encode = EncodeAVX2;
+    codec.decode = DecodeAVX2;
+  } else if (features.ssse3) {
+    codec.encode = EncodeSSSE3;
+    codec.decode = DecodeSSSE3;
+  }
+#endif
+  return codec;
+}
+
+static const Codec &GetCodec() {
+  static const Codec codec = SelectCodec();
+  return codec;
+}
+
+void Encode(const uint8_t *p, size_t size, char *out) {
+  GetCodec().encode(p, size, out);
+}
+
+std::string Encode(const uint8_t *p, size_t size) {
+  std::string str(size * 2, '\0');
+  Encode(p, size, &str[0]);
+  return str;
+}
+
+std::string Encode(const std::vector<uint8_t> &data) {
+  return Encode(data.data(), data.size());
+}
+
+bool Decode(const char *str, size_t size, uint8_t *out) {
+  return GetCodec().decode(str, size, out);
+}
+
+bool Decode(const std::string &str, std::vector<uint8_t> &out) {
+  if (str.size() % 2 != 0) return false;
+  out.resize(str.size() / 2);
+  return Decode(str.data(), out.size(), out.data());
+}
+
+}  // namespace hex
+}  // namespace coin
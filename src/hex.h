@@ -0,0 +1,55 @@
+#ifndef __HEX_H__
+#define __HEX_H__
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <vector>
+
+namespace coin {
+namespace hex {
+
+/**
+ * Encode bytes to lowercase hex.
+ *
+ * Runs 32 (AVX2) or 16 (SSSE3) bytes at a time when the CPU supports it.
+ *
+ * @param p Data.
+ * @param size Size of data.
+ * @param out Output, 2 * size characters, not null terminated.
+ */
+void Encode(const uint8_t *p, size_t size, char *out);
+
+/// Encode bytes to lowercase hex string.
+std::string Encode(const uint8_t *p, size_t size);
+
+/// Encode bytes to lowercase hex string.
+std::string Encode(const std::vector<uint8_t> &data);
+
+/**
+ * Decode hex, both upper and lower case digits are accepted.
+ *
+ * @param str Hex characters, 2 * size of them.
+ * @param size Number of bytes to decode.
+ * @param out Output, size bytes.
+ *
+ * @return False if a character is not a hex digit, out is undefined then.
+ */
+bool Decode(const char *str, size_t size, uint8_t *out);
+
+/**
+ * Decode hex string.
+ *
+ * @param str Hex string, even number of characters.
+ * @param out Decoded bytes.
+ *
+ * @return False if the string has odd length or a character is not a hex
+ * digit.
+ */
+bool Decode(const std::string &str, std::vector<uint8_t> &out);
+
+}  // namespace hex
+}  // namespace coin
+
+#endif
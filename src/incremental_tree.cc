@@ -0,0 +1,78 @@
+#include "incremental_tree.h"
+
+namespace coin {
+namespace mt {
+
+void IncrementalTree::Assign(const uint8_t *leaves, size_t n) {
+  Clear();
+  if (n == 0) return;
+  levels_.emplace_back(leaves, leaves + n * HASH_SIZE);
+  ResizeLevels();
+  for (size_t level = 1; level < levels_.size(); ++level) {
+    size_t children = level_size(level - 1), pairs = children / 2;
+    HashNodes(levels_[level - 1].data(), pairs, levels_[level].data(), mode_);
+    if (children % 2 == 1) UpdateNode(level, pairs);
+  }
+}
+
+void IncrementalTree::Append(const uint8_t *leaf) {
+  if (levels_.empty()) levels_.emplace_back();
+  levels_[0].insert(levels_[0].end(), leaf, leaf + HASH_SIZE);
+  ResizeLevels();
+  UpdatePath(size() - 1);
+}
+
+void IncrementalTree::Replace(size_t index, const uint8_t *leaf) {
+  assert(index < size());
+  memcpy(levels_[0].data() + index * HASH_SIZE, leaf, HASH_SIZE);
+  UpdatePath(index);
+}
+
+void IncrementalTree::RemoveLast() {
+  assert(!empty());
+  levels_[0].resize(levels_[0].size() - HASH_SIZE);
+  if (levels_[0].empty()) {
+    Clear();
+    return;
+  }
+  ResizeLevels();
+  // The new last leaf may have lost its sibling.
+  UpdatePath(size() - 1);
+}
+
+data::Buffer IncrementalTree::Root() const {
+  data::Buffer root;
+  if (!empty()) root.CopyFrom(GetRoot(), HASH_SIZE);
+  return root;
+}
+
+void IncrementalTree::ResizeLevels() {
+  size_t level = 0, n = size();
+  while (n > 1) {
+    n = (n + 1) / 2;
+    if (++level == levels_.size()) levels_.emplace_back();
+    levels_[level].resize(n * HASH_SIZE);
+  }
+  levels_.resize(level + 1);
+}
+
+void IncrementalTree::UpdatePath(size_t index) {
+  for (size_t level = 1; level < levels_.size(); ++level) {
+    index /= 2;
+    UpdateNode(level, index);
+  }
+}
+
+void IncrementalTree::UpdateNode(size_t level, size_t index) {
+  const std::vector<uint8_t> &children = levels_[level - 1];
+  const uint8_t *left = children.data() + index * 2 * HASH_SIZE;
+  uint8_t *out = levels_[level].data() + index * HASH_SIZE;
+  if ((index * 2 + 1) * HASH_SIZE < children.size()) {
+    HashNode(left, left + HASH_SIZE, out, mode_);
+  } else {
+    memcpy(out, left, HASH_SIZE);
+  }
+}
+
+}  // namespace mt
+}  // namespace coin
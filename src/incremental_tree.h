@@ -0,0 +1,104 @@
+#ifndef __INCREMENTAL_TREE_H__
+#define __INCREMENTAL_TREE_H__
+
+#include <cstdint>
+
+#include <vector>
+
+#include "data_value.h"
+#include "merkle_tree.h"
+
+namespace coin {
+namespace mt {
+
+/**
+ * Merkle tree of leaf hash values which changes one leaf at a time.
+ *
+ * Append(), Replace() and RemoveLast() rehash only the path from the changed
+ * leaf to the root, O(log n) node hashes. Nodes are kept level by level, an
+ * odd node at the end of a level is promoted as in MakeMerkleTree(), so the
+ * root is always the same as a full build over the current leaves.
+ */
+class IncrementalTree {
+ public:
+  /// Create an empty tree hashing parent nodes with `mode`.
+  explicit IncrementalTree(NodeHashMode mode = NodeHashMode::Builder)
+      : mode_(mode) {}
+
+  NodeHashMode get_node_hash_mode() const { return mode_; }
+
+  /**
+   * Replace all leaves and build the whole tree.
+   *
+   * @param leaves `n` consecutive leaf hash values, HASH_SIZE bytes each.
+   * @param n Number of leaves.
+   */
+  void Assign(const uint8_t *leaves, size_t n);
+
+  /// Add a leaf hash value, HASH_SIZE bytes.
+  void Append(const uint8_t *leaf);
+  void Append(const data::Buffer &leaf) {
+    assert(leaf.value.size() == HASH_SIZE);
+    Append(leaf.value.data());
+  }
+
+  /// Change the hash value of leaf `index`.
+  void Replace(size_t index, const uint8_t *leaf);
+  void Replace(size_t index, const data::Buffer &leaf) {
+    assert(leaf.value.size() == HASH_SIZE);
+    Replace(index, leaf.value.data());
+  }
+
+  /// Remove the last leaf.
+  void RemoveLast();
+
+  /// Remove all leaves.
+  void Clear() { levels_.clear(); }
+
+  bool empty() const { return levels_.empty(); }
+
+  /// Number of leaves.
+  size_t size() const { return level_size(0); }
+
+  /// Number of levels including the leaves and the root, 0 if empty.
+  size_t level_count() const { return levels_.size(); }
+
+  /// Number of nodes in a level, level 0 is the leaves.
+  size_t level_size(size_t level) const {
+    return level < levels_.size() ? levels_[level].size() / HASH_SIZE : 0;
+  }
+
+  /// Hash value of a node, HASH_SIZE bytes.
+  const uint8_t *GetHash(size_t level, size_t index) const {
+    assert(index < level_size(level));
+    return levels_[level].data() + index * HASH_SIZE;
+  }
+
+  /// Hash value of a leaf.
+  const uint8_t *GetLeafHash(size_t index) const { return GetHash(0, index); }
+
+  /// Root hash value, HASH_SIZE bytes.
+  const uint8_t *GetRoot() const { return levels_.back().data(); }
+
+  /// Root hash value, empty if there are no leaves.
+  data::Buffer Root() const;
+
+ private:
+  /// Resize parent levels to the number of leaves.
+  void ResizeLevels();
+
+  /// Rehash the parents of leaf `index` up to the root.
+  void UpdatePath(size_t index);
+
+  /// Hash node `index` of `level` from its children.
+  void UpdateNode(size_t level, size_t index);
+
+ private:
+  NodeHashMode mode_;
+  std::vector<std::vector<uint8_t>> levels_;
+};
+
+}  // namespace mt
+}  // namespace coin
+
+#endif
@@ -57,14 +57,17 @@ PubKey Key::CreatePubKey() const { return PubKey(pub_key_data_); }
 std::vector<uint8_t> Key::Sign(const std::vector<uint8_t> &hash) const {
   // Make signature.
   secp256k1_ecdsa_signature sig;
-  assert(secp256k1_ecdsa_sign(ctx_, &sig, hash.data(), priv_key_data_.data(),
-                              secp256k1_nonce_function_rfc6979, nullptr) == 1);
+  int ok = secp256k1_ecdsa_sign(ctx_, &sig, hash.data(), priv_key_data_.data(),
+                                secp256k1_nonce_function_rfc6979, nullptr);
+  assert(ok == 1);
 
   // Serialize signature.
   std::vector<uint8_t> sig_out(72);
   size_t sig_out_size = 72;
-  assert(secp256k1_ecdsa_signature_serialize_der(
-             ctx_, (unsigned char *)sig_out.data(), &sig_out_size, &sig) == 1);
+  ok = secp256k1_ecdsa_signature_serialize_der(
+      ctx_, (unsigned char *)sig_out.data(), &sig_out_size, &sig);
+  assert(ok == 1);
+  (void)ok;
 
   // Returns
   sig_out.resize(sig_out_size);
@@ -74,15 +77,17 @@ std::vector<uint8_t> Key::Sign(const std::vector<uint8_t> &hash) const {
 void Key::CalculatePublicKey(bool compressed) {
   // Calculate public key.
   secp256k1_pubkey pubkey;
-  assert(secp256k1_ec_pubkey_create(ctx_, &pubkey, priv_key_data_.data()) == 1);
+  int ok = secp256k1_ec_pubkey_create(ctx_, &pubkey, priv_key_data_.data());
+  assert(ok == 1);
 
   // Serialize public key.
   size_t out_size = PUBLIC_KEY_SIZE;
   pub_key_data_.resize(out_size);
-  assert(secp256k1_ec_pubkey_serialize(
-             ctx_, pub_key_data_.data(), &out_size, &pubkey,
-             compressed ? SECP256K1_EC_COMPRESSED
-                        : SECP256K1_EC_UNCOMPRESSED) == 1);
+  ok = secp256k1_ec_pubkey_serialize(
+      ctx_, pub_key_data_.data(), &out_size, &pubkey,
+      compressed ? SECP256K1_EC_COMPRESSED : SECP256K1_EC_UNCOMPRESSED);
+  assert(ok == 1);
+  (void)ok;
   pub_key_data_.resize(out_size);
 }
 
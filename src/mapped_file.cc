@@ -0,0 +1,76 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace coin {
+
+bool MappedFile::Open(const std::string &path, bool writable) {
+  Close();
+  int fd = open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+  if (fd < 0) return false;
+  return Map(fd, writable);
+}
+
+bool MappedFile::Create(const std::string &path, uint64_t size) {
+  Close();
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return false;
+  if (ftruncate(fd, size) != 0) {
+    close(fd);
+    return false;
+  }
+  return Map(fd, true);
+}
+
+void MappedFile::AdviseSequential() {
+  if (data_ != nullptr) madvise(data_, size_, MADV_SEQUENTIAL);
+}
+
+void MappedFile::AdviseRandom() {
+  if (data_ != nullptr) madvise(data_, size_, MADV_RANDOM);
+}
+
+bool MappedFile::Sync() {
+  if (!writable_ || data_ == nullptr) return writable_;
+  return msync(data_, size_, MS_SYNC) == 0;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  open_ = false;
+  writable_ = false;
+}
+
+bool MappedFile::Map(int fd, bool writable) {
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  size_ = st.st_size;
+  if (size_ > 0) {
+    int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    int flags = writable ? MAP_SHARED : MAP_PRIVATE;
+    void *p = mmap(nullptr, size_, prot, flags, fd, 0);
+    if (p == MAP_FAILED) {
+      close(fd);
+      size_ = 0;
+      return false;
+    }
+    data_ = static_cast<uint8_t *>(p);
+  }
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+  open_ = true;
+  writable_ = writable;
+  return true;
+}
+
+}  // namespace coin
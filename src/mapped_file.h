@@ -0,0 +1,80 @@
+#ifndef __MAPPED_FILE_H__
+#define __MAPPED_FILE_H__
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+
+namespace coin {
+
+/// Memory mapping of a whole file.
+class MappedFile {
+ public:
+  MappedFile() {}
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  ~MappedFile() { Close(); }
+
+  /**
+   * Map a file.
+   *
+   * @param path File path.
+   * @param writable Map shared and writable, changes go to the file.
+   *
+   * @return False if the file cannot be opened or mapped.
+   */
+  bool Open(const std::string &path, bool writable = false);
+
+  /**
+   * Create or truncate a file of `size` bytes and map it writable.
+   *
+   * @param path File path.
+   * @param size File size, the content is zero.
+   *
+   * @return False if the file cannot be created or mapped.
+   */
+  bool Create(const std::string &path, uint64_t size);
+
+  /// Hint that the content is read front to back, more is read ahead.
+  void AdviseSequential();
+
+  /// Hint that the content is read at random, e.g. tree nodes.
+  void AdviseRandom();
+
+  /// Write changes of a writable mapping to the file.
+  bool Sync();
+
+  /// Unmap the file.
+  void Close();
+
+  bool is_open() const { return open_; }
+
+  bool is_writable() const { return writable_; }
+
+  /// File content, nullptr for an empty file.
+  const uint8_t *get_data() const { return data_; }
+
+  /// File content of a writable mapping.
+  uint8_t *get_mutable_data() {
+    return writable_ ? data_ : nullptr;
+  }
+
+  uint64_t get_size() const { return size_; }
+
+ private:
+  /// Map an open descriptor, which is closed in any case.
+  bool Map(int fd, bool writable);
+
+ private:
+  uint8_t *data_ = nullptr;
+  uint64_t size_ = 0;
+  bool open_ = false;
+  bool writable_ = false;
+};
+
+}  // namespace coin
+
+#endif
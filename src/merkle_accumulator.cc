@@ -0,0 +1,39 @@
+#include "merkle_accumulator.h"
+
+namespace coin {
+namespace mt {
+
+void RootAccumulator::Push(const uint8_t *leaf) {
+  uint8_t carry[HASH_SIZE];
+  memcpy(carry, leaf, HASH_SIZE);
+  // Merge with the pending subtrees of the same size, like a binary counter.
+  size_t level = 0;
+  while ((size_ >> level) & 1) {
+    HashNode(pending_[level], carry, carry, mode_);
+    ++level;
+  }
+  memcpy(pending_[level], carry, HASH_SIZE);
+  ++size_;
+}
+
+bool RootAccumulator::Root(uint8_t *root) const {
+  if (size_ == 0) return false;
+  size_t level = 0;
+  while (((size_ >> level) & 1) == 0) ++level;
+  // The lowest subtree is promoted until it meets a pending left sibling.
+  memcpy(root, pending_[level], HASH_SIZE);
+  for (++level; level < 64; ++level) {
+    if ((size_ >> level) & 1) HashNode(pending_[level], root, root, mode_);
+  }
+  return true;
+}
+
+data::Buffer RootAccumulator::Root() const {
+  data::Buffer root;
+  root.value.resize(HASH_SIZE);
+  if (!Root(root.value.data())) root.value.clear();
+  return root;
+}
+
+}  // namespace mt
+}  // namespace coin
@@ -0,0 +1,66 @@
+#ifndef __MERKLE_ACCUMULATOR_H__
+#define __MERKLE_ACCUMULATOR_H__
+
+#include <cstdint>
+
+#include "data_value.h"
+#include "merkle_tree.h"
+
+namespace coin {
+namespace mt {
+
+/**
+ * Merkle root of leaf hash values pushed one at a time.
+ *
+ * Keeps at most one pending hash value per level, a complete subtree waiting
+ * for its right sibling: O(log n) memory, no allocation. Root() folds the
+ * pending subtrees from the lowest level up, which is the odd node promotion
+ * of MakeMerkleTree(), so both give the same root.
+ */
+class RootAccumulator {
+ public:
+  /// Create an empty accumulator hashing parent nodes with `mode`.
+  explicit RootAccumulator(NodeHashMode mode = NodeHashMode::Builder)
+      : mode_(mode) {}
+
+  NodeHashMode get_node_hash_mode() const { return mode_; }
+
+  /// Add the next leaf hash value, HASH_SIZE bytes.
+  void Push(const uint8_t *leaf);
+  void Push(const data::Buffer &leaf) {
+    assert(leaf.value.size() == HASH_SIZE);
+    Push(leaf.value.data());
+  }
+
+  /// Number of leaves pushed.
+  uint64_t size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+  /// Remove all leaves.
+  void Clear() { size_ = 0; }
+
+  /**
+   * Calculate root of the leaves pushed so far, more leaves can follow.
+   *
+   * @param root HASH_SIZE bytes output.
+   *
+   * @return False if no leaf was pushed.
+   */
+  bool Root(uint8_t *root) const;
+
+  /// Root hash value, empty if no leaf was pushed.
+  data::Buffer Root() const;
+
+ private:
+  /// Level `i` holds a pending subtree of 2^i leaves when bit `i` of size_
+  /// is set.
+  NodeHashMode mode_;
+  uint8_t pending_[64][HASH_SIZE];
+  uint64_t size_ = 0;
+};
+
+}  // namespace mt
+}  // namespace coin
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef __MERKLE_DIFF_H__
+#define __MERKLE_DIFF_H__
+
+#include <cstdint>
+
+#include <vector>
+
+#include "data_value.h"
+#include "fd_stream.h"
+#include "merkle_tree.h"
+
+namespace coin {
+namespace mt {
+
+/**
+ * Find the leaves whose hash values differ between two trees.
+ *
+ * Descends from the root into mismatching subtrees only, O(k log n) node
+ * comparisons for k differing leaves. Works with every tree exposing
+ * level_count(), level_size(level) and GetHash(level, index), e.g. FlatTree
+ * and IncrementalTree.
+ *
+ * @param a First tree.
+ * @param b Second tree.
+ * @param diff Indices of differing leaves, increasing.
+ *
+ * @return False if the trees have a different number of leaves.
+ */
+template <typename TreeA, typename TreeB>
+bool DiffTrees(const TreeA &a, const TreeB &b, std::vector<uint64_t> &diff) {
+  diff.clear();
+  if (a.level_count() != b.level_count()) return false;
+  if (a.level_count() == 0) return true;
+  if (a.level_size(0) != b.level_size(0)) return false;
+
+  // Mismatching nodes of the current level, increasing.
+  std::vector<uint64_t> nodes(1, 0), next;
+  for (size_t level = a.level_count(); level-- > 0;) {
+    next.clear();
+    for (uint64_t index : nodes) {
+      if (memcmp(a.GetHash(level, index), b.GetHash(level, index),
+                 HASH_SIZE) == 0) {
+        continue;
+      }
+      if (level == 0) {
+        diff.push_back(index);
+        continue;
+      }
+      next.push_back(index * 2);
+      if (index * 2 + 1 < a.level_size(level - 1)) {
+        next.push_back(index * 2 + 1);
+      }
+    }
+    nodes.swap(next);
+  }
+  return true;
+}
+
+/// Level value ending a diff session.
+const uint32_t DIFF_END = UINT32_MAX;
+
+/**
+ * Serve node hash values of a tree to a DiffRemote() peer.
+ *
+ * Sends the leaf count, then answers each request, a level and a list of
+ * node indices, with the hash values of those nodes until the peer ends the
+ * session. Each answer is flushed as a whole.
+ *
+ * @param s Connected stream.
+ * @param tree Local tree.
+ *
+ * @return False on I/O error or an invalid request.
+ */
+template <typename Tree>
+bool ServeDiff(FdStream &s, const Tree &tree) {
+  uint64_t leaf_count = tree.level_count() ? tree.level_size(0) : 0;
+  data::MakeValue(leaf_count).WriteToStream(s);
+  std::vector<uint8_t> hashes;
+  while (s.good()) {
+    uint32_t level = data::ReadValue<uint32_t>(s);
+    if (!s.good()) return false;
+    if (level == DIFF_END) return true;
+    uint32_t count = data::ReadValue<uint32_t>(s);
+    if (level >= tree.level_count() || count > tree.level_size(level)) {
+      return false;
+    }
+    hashes.resize(count * HASH_SIZE);
+    for (uint32_t i = 0; i < count && s.good(); ++i) {
+      uint64_t index = data::ReadValue<uint64_t>(s);
+      if (index >= tree.level_size(level)) return false;
+      memcpy(hashes.data() + i * HASH_SIZE, tree.GetHash(level, index),
+             HASH_SIZE);
+    }
+    s.write(reinterpret_cast<const char *>(hashes.data()), hashes.size());
+    s.Flush();
+  }
+  return false;
+}
+
+/**
+ * Find leaves differing from a tree served by ServeDiff() on the peer.
+ *
+ * Each round trip asks for the children of the mismatching nodes of one
+ * level, starting with the root. Only O(k log n) node hash values travel for
+ * k differing leaves.
+ *
+ * @param s Connected stream.
+ * @param tree Local tree.
+ * @param diff Indices of differing leaves, increasing.
+ *
+ * @return False on I/O error or if the trees have a different number of
+ * leaves.
+ */
+template <typename Tree>
+bool DiffRemote(FdStream &s, const Tree &tree, std::vector<uint64_t> &diff) {
+  diff.clear();
+  uint64_t leaf_count = tree.level_count() ? tree.level_size(0) : 0;
+  uint64_t remote_leaf_count = data::ReadValue<uint64_t>(s);
+  if (!s.good()) return false;
+  if (remote_leaf_count != leaf_count || leaf_count == 0) {
+    data::MakeValue(DIFF_END).WriteToStream(s);
+    return s.Flush() && leaf_count == remote_leaf_count;
+  }
+
+  std::vector<uint64_t> nodes(1, 0), next;
+  std::vector<uint8_t> hashes;
+  for (size_t level = tree.level_count(); level-- > 0 && !nodes.empty();) {
+    data::MakeValue(static_cast<uint32_t>(level)).WriteToStream(s);
+    data::MakeValue(static_cast<uint32_t>(nodes.size())).WriteToStream(s);
+    for (uint64_t index : nodes) data::MakeValue(index).WriteToStream(s);
+    hashes.resize(nodes.size() * HASH_SIZE);
+    s.read(reinterpret_cast<char *>(hashes.data()), hashes.size());
+    if (!s.good()) return false;
+
+    next.clear();
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      uint64_t index = nodes[i];
+      if (memcmp(hashes.data() + i * HASH_SIZE, tree.GetHash(level, index),
+                 HASH_SIZE) == 0) {
+        continue;
+      }
+      if (level == 0) {
+        diff.push_back(index);
+        continue;
+      }
+      next.push_back(index * 2);
+      if (index * 2 + 1 < tree.level_size(level - 1)) {
+        next.push_back(index * 2 + 1);
+      }
+    }
+    nodes.swap(next);
+  }
+  data::MakeValue(DIFF_END).WriteToStream(s);
+  return s.Flush();
+}
+
+}  // namespace mt
+}  // namespace coin
+
+#endif
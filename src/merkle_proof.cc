@@ -0,0 +1,114 @@
+#include "merkle_proof.h"
+
+namespace coin {
+namespace mt {
+
+/// True if the position bits are the bits of the leaf index with some 0
+/// bits, those of the levels the node is promoted on, left out.
+static bool MatchesLeafIndex(const Proof &proof) {
+  if (proof.num_siblings < MAX_PROOF_DEPTH &&
+      proof.position_bits >> proof.num_siblings != 0) {
+    return false;
+  }
+  uint64_t index = proof.leaf_index;
+  for (size_t i = 0; i < proof.num_siblings; ++i) {
+    if ((proof.position_bits >> i) & 1) {
+      while (index != 0 && (index & 1) == 0) index >>= 1;
+      if ((index & 1) == 0) return false;
+    } else if (index & 1) {
+      return false;
+    }
+    index >>= 1;
+  }
+  return index == 0;
+}
+
+bool VerifyProof(const uint8_t *leaf_hash, const Proof &proof,
+                 const uint8_t *root, NodeHashMode mode) {
+  if (proof.num_siblings > MAX_PROOF_DEPTH || !MatchesLeafIndex(proof)) {
+    return false;
+  }
+  uint8_t hash[HASH_SIZE];
+  memcpy(hash, leaf_hash, HASH_SIZE);
+  for (size_t i = 0; i < proof.num_siblings; ++i) {
+    if ((proof.position_bits >> i) & 1) {
+      HashNode(proof.siblings[i], hash, hash, mode);
+    } else {
+      HashNode(hash, proof.siblings[i], hash, mode);
+    }
+  }
+  return memcmp(hash, root, HASH_SIZE) == 0;
+}
+
+bool VerifyProof(const uint8_t *leaf_hash, const Proof &proof,
+                 const uint8_t *root, uint64_t leaf_count,
+                 NodeHashMode mode) {
+  if (proof.leaf_index >= leaf_count) return false;
+  // Same walk as MakeProof().
+  uint64_t position_bits = 0;
+  size_t num_siblings = 0;
+  uint64_t index = proof.leaf_index;
+  for (uint64_t level_size = leaf_count; level_size > 1;
+       level_size = (level_size + 1) / 2) {
+    if ((index ^ 1) < level_size) {
+      position_bits |= (index & 1) << num_siblings;
+      ++num_siblings;
+    }
+    index /= 2;
+  }
+  if (num_siblings != proof.num_siblings ||
+      position_bits != proof.position_bits) {
+    return false;
+  }
+  return VerifyProof(leaf_hash, proof, root, mode);
+}
+
+bool VerifyMultiProof(const uint8_t *leaf_hashes, const MultiProof &proof,
+                      const uint8_t *root, NodeHashMode mode) {
+  const std::vector<uint64_t> &leaf_indices = proof.leaf_indices;
+  if (leaf_indices.empty() || leaf_indices.back() >= proof.leaf_count ||
+      proof.hashes.size() % HASH_SIZE != 0) {
+    return false;
+  }
+  for (size_t i = 1; i < leaf_indices.size(); ++i) {
+    if (leaf_indices[i - 1] >= leaf_indices[i]) return false;
+  }
+
+  // Known nodes of the current level, hashes are updated in place.
+  std::vector<uint64_t> known(leaf_indices);
+  std::vector<uint8_t> hashes(leaf_hashes,
+                              leaf_hashes + known.size() * HASH_SIZE);
+  const uint8_t *sibling = proof.hashes.data();
+  const uint8_t *sibling_end = sibling + proof.hashes.size();
+  for (uint64_t level_size = proof.leaf_count; level_size > 1;
+       level_size = (level_size + 1) / 2) {
+    size_t num_parents = 0;
+    for (size_t i = 0; i < known.size(); ++i) {
+      uint64_t index = known[i];
+      uint8_t *hash = hashes.data() + i * HASH_SIZE;
+      uint8_t *parent = hashes.data() + num_parents * HASH_SIZE;
+      if (index % 2 == 0 && i + 1 < known.size() && known[i + 1] == index + 1) {
+        HashNode(hash, hash + HASH_SIZE, parent, mode);
+        ++i;
+      } else if ((index ^ 1) < level_size) {
+        if (sibling_end - sibling < static_cast<ptrdiff_t>(HASH_SIZE)) {
+          return false;
+        }
+        if (index % 2 == 0) {
+          HashNode(hash, sibling, parent, mode);
+        } else {
+          HashNode(sibling, hash, parent, mode);
+        }
+        sibling += HASH_SIZE;
+      } else {
+        memmove(parent, hash, HASH_SIZE);
+      }
+      known[num_parents++] = index / 2;
+    }
+    known.resize(num_parents);
+  }
+  return sibling == sibling_end && memcmp(hashes.data(), root, HASH_SIZE) == 0;
+}
+
+}  // namespace mt
+}  // namespace coin
@@ -0,0 +1,266 @@
+#ifndef __MERKLE_PROOF_H__
+#define __MERKLE_PROOF_H__
+
+#include <cstdint>
+
+#include <algorithm>
+#include <vector>
+
+#include "data_value.h"
+#include "merkle_tree.h"
+
+namespace coin {
+namespace mt {
+
+/// Maximal number of siblings in a proof, enough for 2^64 leaves.
+const size_t MAX_PROOF_DEPTH = 64;
+
+/**
+ * Inclusion proof of one leaf, the authentication path to the root.
+ *
+ * Siblings are ordered from the leaf level up. Levels where the node is
+ * promoted have no sibling and are skipped. Bit `i` of `position_bits` is 1
+ * when sibling `i` is the left child, i.e. the path node is on the right.
+ *
+ * Proof has a fixed size and never allocates.
+ */
+struct Proof {
+  uint64_t leaf_index = 0;
+  uint64_t position_bits = 0;
+  uint8_t num_siblings = 0;
+  uint8_t siblings[MAX_PROOF_DEPTH][HASH_SIZE];
+
+  /// Bytes written by Serialize().
+  size_t GetSerializedSize() const {
+    return sizeof(leaf_index) + sizeof(position_bits) + sizeof(num_siblings) +
+           num_siblings * HASH_SIZE;
+  }
+
+  template <typename Stream>
+  void Serialize(Stream &s) const {
+    data::MakeValue(leaf_index).WriteToStream(s);
+    data::MakeValue(position_bits).WriteToStream(s);
+    data::MakeValue(num_siblings).WriteToStream(s);
+    s.write(reinterpret_cast<const char *>(siblings), num_siblings * HASH_SIZE);
+  }
+
+  template <typename Stream>
+  void Unserialize(Stream &s) {
+    leaf_index = data::ReadValue<uint64_t>(s);
+    position_bits = data::ReadValue<uint64_t>(s);
+    num_siblings = data::ReadValue<uint8_t>(s);
+    // Untrusted input, a longer path than a proof can have fails the stream.
+    if (num_siblings > MAX_PROOF_DEPTH) {
+      num_siblings = 0;
+      data::MarkStreamFailed(s);
+      return;
+    }
+    s.read(reinterpret_cast<char *>(siblings), num_siblings * HASH_SIZE);
+  }
+};
+
+/**
+ * Make inclusion proof of a leaf.
+ *
+ * Works with every tree exposing level_count(), level_size(level) and
+ * GetHash(level, index), e.g. FlatTree and IncrementalTree.
+ *
+ * @param tree Merkle tree.
+ * @param leaf_index Index of the leaf.
+ * @param proof Output proof.
+ *
+ * @return False if the leaf does not exist.
+ */
+template <typename Tree>
+bool MakeProof(const Tree &tree, size_t leaf_index, Proof &proof) {
+  if (tree.level_count() == 0 || leaf_index >= tree.level_size(0)) {
+    return false;
+  }
+  proof.leaf_index = leaf_index;
+  proof.position_bits = 0;
+  proof.num_siblings = 0;
+  size_t index = leaf_index;
+  for (size_t level = 0; level + 1 < tree.level_count(); ++level) {
+    size_t sibling = index ^ 1;
+    if (sibling < tree.level_size(level)) {
+      memcpy(proof.siblings[proof.num_siblings], tree.GetHash(level, sibling),
+             HASH_SIZE);
+      proof.position_bits |= static_cast<uint64_t>(index & 1)
+                             << proof.num_siblings;
+      ++proof.num_siblings;
+    }
+    index /= 2;
+  }
+  return true;
+}
+
+/**
+ * Verify inclusion proof of a leaf, allocates nothing.
+ *
+ * The position bits must be the bits of `proof.leaf_index` with the levels
+ * the node is promoted on left out, which are 0. Without the number of
+ * leaves that does not pin the index down completely, use the overload
+ * taking `leaf_count` when the index matters.
+ *
+ * @param leaf_hash Hash value of the leaf, HASH_SIZE bytes.
+ * @param proof Proof of the leaf.
+ * @param root Root hash value, HASH_SIZE bytes.
+ * @param mode Node hash mode of the tree.
+ *
+ * @return True if the path from the leaf ends at root.
+ */
+bool VerifyProof(const uint8_t *leaf_hash, const Proof &proof,
+                 const uint8_t *root,
+                 NodeHashMode mode = NodeHashMode::Builder);
+
+/**
+ * Verify inclusion proof of a leaf at `proof.leaf_index` of a tree with a
+ * known number of leaves, e.g. from a block header.
+ *
+ * The path is derived from the index and the number of leaves, the proof
+ * must match it exactly.
+ *
+ * @param leaf_hash Hash value of the leaf, HASH_SIZE bytes.
+ * @param proof Proof of the leaf.
+ * @param root Root hash value, HASH_SIZE bytes.
+ * @param leaf_count Number of leaves of the tree.
+ * @param mode Node hash mode of the tree.
+ *
+ * @return True if the proof is the path of that leaf and ends at root.
+ */
+bool VerifyProof(const uint8_t *leaf_hash, const Proof &proof,
+                 const uint8_t *root, uint64_t leaf_count,
+                 NodeHashMode mode = NodeHashMode::Builder);
+
+/// Most leaves a MultiProof read by Unserialize() can prove.
+const size_t MAX_MULTI_PROOF_LEAVES = 4096;
+
+/**
+ * Inclusion proof of several leaves of the same tree.
+ *
+ * Holds each node hash needed to rebuild the root exactly once. Nodes that
+ * can be calculated from the proven leaves themselves are left out, so
+ * proofs of leaves close to each other share their upper levels.
+ *
+ * Hash values are ordered level by level from the leaves up and by index
+ * inside each level, which is the order the verifier needs them.
+ */
+struct MultiProof {
+  uint64_t leaf_count = 0;
+  /// Proven leaves, strictly increasing.
+  std::vector<uint64_t> leaf_indices;
+  /// Sibling hash values, HASH_SIZE bytes each.
+  std::vector<uint8_t> hashes;
+
+  size_t num_hashes() const { return hashes.size() / HASH_SIZE; }
+
+  /// Bytes written by Serialize().
+  size_t GetSerializedSize() const {
+    return sizeof(leaf_count) + sizeof(uint32_t) +
+           leaf_indices.size() * sizeof(uint64_t) + sizeof(uint32_t) +
+           hashes.size();
+  }
+
+  template <typename Stream>
+  void Serialize(Stream &s) const {
+    data::MakeValue(leaf_count).WriteToStream(s);
+    data::MakeValue(static_cast<uint32_t>(leaf_indices.size()))
+        .WriteToStream(s);
+    for (uint64_t index : leaf_indices) {
+      data::MakeValue(index).WriteToStream(s);
+    }
+    data::MakeValue(static_cast<uint32_t>(num_hashes())).WriteToStream(s);
+    s.write(reinterpret_cast<const char *>(hashes.data()), hashes.size());
+  }
+
+  template <typename Stream>
+  void Unserialize(Stream &s) {
+    leaf_indices.clear();
+    hashes.clear();
+    leaf_count = data::ReadValue<uint64_t>(s);
+    // Untrusted input, larger counts than a valid proof has fail the
+    // stream and leave the proof empty.
+    size_t num_leaves = data::ReadValue<uint32_t>(s);
+    if (num_leaves > MAX_MULTI_PROOF_LEAVES) {
+      data::MarkStreamFailed(s);
+      return;
+    }
+    leaf_indices.resize(num_leaves);
+    for (uint64_t &index : leaf_indices) {
+      index = data::ReadValue<uint64_t>(s);
+    }
+    size_t n = data::ReadValue<uint32_t>(s);
+    if (n > num_leaves * MAX_PROOF_DEPTH) {
+      leaf_indices.clear();
+      data::MarkStreamFailed(s);
+      return;
+    }
+    hashes.resize(n * HASH_SIZE);
+    s.read(reinterpret_cast<char *>(hashes.data()), hashes.size());
+  }
+};
+
+/**
+ * Make inclusion proof of several leaves.
+ *
+ * @param tree Merkle tree, see MakeProof().
+ * @param leaf_indices Leaves to prove, in any order, duplicates are removed.
+ * @param proof Output proof.
+ *
+ * @return False if a leaf does not exist.
+ */
+template <typename Tree>
+bool MakeMultiProof(const Tree &tree, std::vector<uint64_t> leaf_indices,
+                    MultiProof &proof) {
+  std::sort(leaf_indices.begin(), leaf_indices.end());
+  leaf_indices.erase(std::unique(leaf_indices.begin(), leaf_indices.end()),
+                     leaf_indices.end());
+  if (tree.level_count() == 0 ||
+      (!leaf_indices.empty() && leaf_indices.back() >= tree.level_size(0))) {
+    return false;
+  }
+  proof.leaf_count = tree.level_size(0);
+  proof.leaf_indices = leaf_indices;
+  proof.hashes.clear();
+
+  // Walk up with the known nodes, add each missing sibling.
+  std::vector<uint64_t> &known = leaf_indices;
+  for (size_t level = 0; level + 1 < tree.level_count(); ++level) {
+    size_t num_parents = 0;
+    for (size_t i = 0; i < known.size(); ++i) {
+      uint64_t index = known[i];
+      if (index % 2 == 0 && i + 1 < known.size() && known[i + 1] == index + 1) {
+        ++i;  // Both children are known.
+      } else if ((index ^ 1) < tree.level_size(level)) {
+        const uint8_t *hash = tree.GetHash(level, index ^ 1);
+        proof.hashes.insert(proof.hashes.end(), hash, hash + HASH_SIZE);
+      }
+      known[num_parents++] = index / 2;
+    }
+    known.resize(num_parents);
+  }
+  return true;
+}
+
+/**
+ * Verify inclusion proof of several leaves.
+ *
+ * Every node on the paths is hashed once, cheaper than verifying a Proof
+ * for each leaf.
+ *
+ * @param leaf_hashes Hash values of the leaves in proof.leaf_indices, in the
+ * same order, HASH_SIZE bytes each.
+ * @param proof Proof of the leaves.
+ * @param root Root hash value, HASH_SIZE bytes.
+ * @param mode Node hash mode of the tree.
+ *
+ * @return True if the leaves and the proof rebuild root.
+ */
+bool VerifyMultiProof(const uint8_t *leaf_hashes, const MultiProof &proof,
+                      const uint8_t *root,
+                      NodeHashMode mode = NodeHashMode::Builder);
+
+}  // namespace mt
+}  // namespace coin
+
+#endif
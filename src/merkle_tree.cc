@@ -3,6 +3,54 @@
 namespace coin {
 namespace mt {
 
+/// Size of a pair in Builder mode, both hash values with size prefixes.
+static const size_t BUILDER_PAIR_SIZE = (sizeof(uint32_t) + HASH_SIZE) * 2;
+
+/// Write a pair the way Hash256Builder absorbs two data::Buffer values.
+static void MakeBuilderPair(const uint8_t *left, const uint8_t *right,
+                            uint8_t *out) {
+  uint32_t size_n = data::utils::HostToNet<uint32_t>(HASH_SIZE);
+  memcpy(out, &size_n, sizeof(size_n));
+  memcpy(out + sizeof(size_n), left, HASH_SIZE);
+  out += sizeof(size_n) + HASH_SIZE;
+  memcpy(out, &size_n, sizeof(size_n));
+  memcpy(out + sizeof(size_n), right, HASH_SIZE);
+}
+
+void HashNode(const uint8_t *left, const uint8_t *right, uint8_t *out,
+              NodeHashMode mode) {
+  if (mode == NodeHashMode::Hash64) {
+    uint8_t pair[HASH_SIZE * 2];
+    memcpy(pair, left, HASH_SIZE);
+    memcpy(pair + HASH_SIZE, right, HASH_SIZE);
+    Hash64To32(pair, out);
+  } else {
+    uint8_t pair[BUILDER_PAIR_SIZE];
+    MakeBuilderPair(left, right, pair);
+    Hash256 algo;
+    algo.Calculate(pair, sizeof(pair));
+    algo.Final();
+    memcpy(out, algo.get_md(), HASH_SIZE);
+  }
+}
+
+void HashNodes(const uint8_t *children, size_t n, uint8_t *out,
+               NodeHashMode mode) {
+  if (mode == NodeHashMode::Hash64) {
+    Hash64To32(children, out, n);
+    return;
+  }
+  std::vector<uint8_t> pairs(n * BUILDER_PAIR_SIZE);
+  std::vector<const uint8_t *> data(n);
+  std::vector<size_t> sizes(n, BUILDER_PAIR_SIZE);
+  for (size_t i = 0; i < n; ++i) {
+    uint8_t *pair = pairs.data() + i * BUILDER_PAIR_SIZE;
+    const uint8_t *left = children + i * 2 * HASH_SIZE;
+    MakeBuilderPair(left, left + HASH_SIZE, pair);
+    data[i] = pair;
+  }
+  sha256::HashMany(data.data(), sizes.data(), n, out);
+}
 
 }  // namespace mt
 }  // namespace coin
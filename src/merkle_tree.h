@@ -10,6 +10,46 @@
 namespace coin {
 namespace mt {
 
+/// Size of a node hash value.
+const size_t HASH_SIZE = sha256::OUTPUT_SIZE;
+
+/**
+ * How the hash value of a parent node is calculated.
+ *
+ * Both modes give different roots. Every tree takes its mode when it is
+ * created, and transaction hashes always use Builder.
+ */
+enum class NodeHashMode {
+  /// Hash256Builder over both length-prefixed child hash values (default).
+  Builder,
+  /// Hash64To32 over both 32-byte child hash values concatenated.
+  Hash64,
+};
+
+/**
+ * Calculate hash value of a parent node.
+ *
+ * @param left Hash value of left child, HASH_SIZE bytes.
+ * @param right Hash value of right child, HASH_SIZE bytes.
+ * @param out Hash value of parent node, HASH_SIZE bytes, may be the same
+ * memory as left or right.
+ * @param mode How the parent is hashed.
+ */
+void HashNode(const uint8_t *left, const uint8_t *right, uint8_t *out,
+              NodeHashMode mode = NodeHashMode::Builder);
+
+/**
+ * Calculate hash values of parent nodes in one batch.
+ *
+ * @param children 2 * n consecutive child hash values, pairs of left and
+ * right.
+ * @param n Number of parent nodes.
+ * @param out n consecutive parent hash values.
+ * @param mode How the parents are hashed.
+ */
+void HashNodes(const uint8_t *children, size_t n, uint8_t *out,
+               NodeHashMode mode = NodeHashMode::Builder);
+
 template <typename T>
 class Node {
  public:
@@ -34,14 +74,18 @@ class Node {
    *
    * @param left Left child.
    * @param right Right child.
-   * @param parent Parent child.
+   * @param mode How the parent is hashed.
    */
-  Node(NodePtr left, NodePtr right) : left_(left), right_(right) {
+  Node(NodePtr left, NodePtr right,
+       NodeHashMode mode = NodeHashMode::Builder)
+      : left_(left), right_(right) {
     if (left_ != nullptr && right_ != nullptr) {
       // Both exist.
-      Hash256Builder hash_builder;
-      hash_builder << left_->get_hash() << right_->get_hash();
-      hash_ = hash_builder.FinalValue();
+      assert(left_->get_hash().value.size() == HASH_SIZE &&
+             right_->get_hash().value.size() == HASH_SIZE);
+      hash_.value.resize(HASH_SIZE);
+      HashNode(left_->get_hash().value.data(),
+               right_->get_hash().value.data(), hash_.value.data(), mode);
     } else if (left_ != nullptr) {
       hash_ = left_->get_hash();
     } else if (right_ != nullptr) {
@@ -51,6 +95,16 @@ class Node {
     }
   }
 
+  /**
+   * Make a parent node with a hash value calculated by the caller.
+   *
+   * @param left Left child.
+   * @param right Right child.
+   * @param hash Hash value of both children.
+   */
+  Node(NodePtr left, NodePtr right, const data::Buffer &hash)
+      : left_(left), right_(right), hash_(hash) {}
+
   /// Get hash value.
   const data::Buffer &get_hash() const { return hash_; }
 
@@ -73,7 +127,8 @@ class Node {
   NodePtr get_right() const { return right_; }
 
   /// Make merkle-tree
-  static NodePtr MakeMerkleTree(const std::vector<NodePtr> &vec_node) {
+  static NodePtr MakeMerkleTree(const std::vector<NodePtr> &vec_node,
+                                NodeHashMode mode = NodeHashMode::Builder) {
     if (vec_node.empty()) return nullptr;
 
     if (vec_node.size() == 1) {
@@ -83,12 +138,26 @@ class Node {
 
     std::vector<NodePtr> next_vec_node;
 
+    // Hash all pairs of this level in one batch.
+    size_t pairs = vec_node.size() / 2;
+    std::vector<uint8_t> children(pairs * 2 * HASH_SIZE);
+    for (size_t k = 0; k < pairs * 2; ++k) {
+      const data::Buffer &hash = vec_node[k]->get_hash();
+      assert(hash.value.size() == HASH_SIZE);
+      memcpy(children.data() + k * HASH_SIZE, hash.value.data(), HASH_SIZE);
+    }
+    std::vector<uint8_t> parents(pairs * HASH_SIZE);
+    HashNodes(children.data(), pairs, parents.data(), mode);
+
     // Get and hash.
+    size_t pair_index = 0;
     auto i = std::begin(vec_node);
     while (i != std::end(vec_node)) {
       NodePtr left = *i;
       if (i + 1 != std::end(vec_node)) {
-        auto pnode = std::make_shared<Node>(*i, *(i + 1));
+        data::Buffer hash;
+        hash.CopyFrom(parents.data() + pair_index++ * HASH_SIZE, HASH_SIZE);
+        auto pnode = std::make_shared<Node>(*i, *(i + 1), hash);
         next_vec_node.push_back(pnode);
         (*i)->set_parent(pnode);
         (*(i + 1))->set_parent(pnode);
@@ -100,7 +169,7 @@ class Node {
     }
 
     // Build tree in next depth.
-    return MakeMerkleTree(next_vec_node);
+    return MakeMerkleTree(next_vec_node, mode);
   }
 
  private:
@@ -115,12 +184,13 @@ class Node {
  * Make a new merkle-tree.
  *
  * @param container Merkle-tree make from values from this container.
+ * @param mode How parent nodes are hashed.
  *
  * @return Root node of merkle-tree
  */
 template <typename Container>
 typename Node<typename Container::value_type>::NodePtr MakeMerkleTree(
-    const Container &container) {
+    const Container &container, NodeHashMode mode = NodeHashMode::Builder) {
   // Build first-level tree nodes.
   std::vector<typename Node<typename Container::value_type>::NodePtr> vec_node;
   // Loop each values from container.
@@ -128,7 +198,7 @@ typename Node<typename Container::value_type>::NodePtr MakeMerkleTree(
     vec_node.emplace_back(
         std::make_shared<Node<typename Container::value_type>>(val));
   }
-  return Node<typename Container::value_type>::MakeMerkleTree(vec_node);
+  return Node<typename Container::value_type>::MakeMerkleTree(vec_node, mode);
 }
 
 }  // namespace mt
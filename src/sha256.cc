@@ -0,0 +1,395 @@
+#include "sha256.h"
+
+#include <cassert>
+#include <cstring>
+
+#include <algorithm>
+#include <vector>
+
+namespace coin {
+namespace sha256 {
+
+alignas(16) const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static const uint32_t IV[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                               0xa54ff53a, 0x510e527f, 0x9b05688c,
+                               0x1f83d9ab, 0x5be0cd19};
+
+static inline uint32_t ReadBE32(const uint8_t *p) {
+  return (static_cast<uint32_t>(p[0]) << 24) |
+         (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+static inline void WriteBE32(uint8_t *p, uint32_t x) {
+  p[0] = x >> 24;
+  p[1] = x >> 16;
+  p[2] = x >> 8;
+  p[3] = x;
+}
+
+static inline uint32_t Rotr(uint32_t x, int n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+void TransformPortable(uint32_t *s, const uint8_t *blocks, size_t n) {
+  uint32_t w[64];
+  while (n--) {
+    for (int i = 0; i < 16; ++i) w[i] = ReadBE32(blocks + i * 4);
+    for (int i = 16; i < 64; ++i) {
+      uint32_t s0 =
+          Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = s[0], b = s[1], c = s[2], d = s[3];
+    uint32_t e = s[4], f = s[5], g = s[6], h = s[7];
+    for (int i = 0; i < 64; ++i) {
+      uint32_t t1 = h + (Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25)) +
+                    ((e & f) ^ (~e & g)) + K[i] + w[i];
+      uint32_t t2 = (Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22)) +
+                    ((a & b) ^ (a & c) ^ (b & c));
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+    s[0] += a;
+    s[1] += b;
+    s[2] += c;
+    s[3] += d;
+    s[4] += e;
+    s[5] += f;
+    s[6] += g;
+    s[7] += h;
+
+    blocks += BLOCK_SIZE;
+  }
+}
+
+/// Message compressed by one kernel lane, with its padding blocks.
+struct Lane {
+  const uint8_t *p;
+  size_t full;    // Complete blocks in p.
+  size_t blocks;  // Complete blocks plus padding blocks.
+  uint8_t tail[BLOCK_SIZE * 2];
+  uint32_t s[8];
+
+  const uint8_t *GetBlock(size_t i) const {
+    return i < full ? p + i * BLOCK_SIZE : tail + (i - full) * BLOCK_SIZE;
+  }
+};
+
+static void InitLane(Lane &lane, const uint8_t *p, size_t size) {
+  lane.p = p;
+  lane.full = size / BLOCK_SIZE;
+  size_t rest = size - lane.full * BLOCK_SIZE;
+  // Padding takes one or two more blocks.
+  size_t tail_blocks = rest + 9 > BLOCK_SIZE ? 2 : 1;
+  lane.blocks = lane.full + tail_blocks;
+  memset(lane.tail, 0, sizeof(lane.tail));
+  if (rest > 0) memcpy(lane.tail, p + lane.full * BLOCK_SIZE, rest);
+  lane.tail[rest] = 0x80;
+  uint64_t bits = static_cast<uint64_t>(size) << 3;
+  uint8_t *len = lane.tail + tail_blocks * BLOCK_SIZE - 8;
+  WriteBE32(len, bits >> 32);
+  WriteBE32(len + 4, bits);
+  memcpy(lane.s, IV, sizeof(lane.s));
+}
+
+/// Compress blocks of a lane from block `from` to the end.
+static void FinishLane(TransformFunc transform, Lane &lane, size_t from,
+                       uint8_t *md) {
+  if (from < lane.full) {
+    transform(lane.s, lane.GetBlock(from), lane.full - from);
+    from = lane.full;
+  }
+  transform(lane.s, lane.GetBlock(from), lane.blocks - from);
+  for (int i = 0; i < 8; ++i) WriteBE32(md + i * 4, lane.s[i]);
+}
+
+/// Absorb and finish a message with a specific kernel.
+static void HashWith(TransformFunc transform, const uint8_t *p, size_t size,
+                     uint8_t *md) {
+  Lane lane;
+  InitLane(lane, p, size);
+  FinishLane(transform, lane, 0, md);
+}
+
+/// Hash `width` messages, compressing their common blocks in lockstep.
+static void HashLanes(TransformFunc transform, TransformLanesFunc transform_n,
+                      size_t width, const uint8_t *const *data,
+                      const size_t *sizes, const size_t *order, uint8_t *md) {
+  const size_t MAX_LANES = 8;
+  assert(width <= MAX_LANES);
+  Lane lanes[MAX_LANES];
+  uint32_t *states[MAX_LANES];
+  const uint8_t *blocks[MAX_LANES];
+  size_t common = SIZE_MAX;
+  for (size_t k = 0; k < width; ++k) {
+    InitLane(lanes[k], data[order[k]], sizes[order[k]]);
+    states[k] = lanes[k].s;
+    common = std::min(common, lanes[k].blocks);
+  }
+  for (size_t b = 0; b < common; ++b) {
+    for (size_t k = 0; k < width; ++k) blocks[k] = lanes[k].GetBlock(b);
+    transform_n(states, blocks);
+  }
+  for (size_t k = 0; k < width; ++k) {
+    FinishLane(transform, lanes[k], common, md + order[k] * OUTPUT_SIZE);
+  }
+}
+
+/// Check a kernel against known answers before it is selected.
+static bool SelfTest(TransformFunc transform) {
+  static const char *MSG_ABC = "abc";
+  static const uint8_t MD_ABC[OUTPUT_SIZE] = {
+      0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40,
+      0xde, 0x5d, 0xae, 0x22, 0x23, 0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17,
+      0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad};
+  static const char *MSG_448 =
+      "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+  static const uint8_t MD_448[OUTPUT_SIZE] = {
+      0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26,
+      0x93, 0x0c, 0x3e, 0x60, 0x39, 0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff,
+      0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1};
+
+  uint8_t md[OUTPUT_SIZE];
+  HashWith(transform, reinterpret_cast<const uint8_t *>(MSG_ABC),
+           strlen(MSG_ABC), md);
+  if (memcmp(md, MD_ABC, OUTPUT_SIZE) != 0) return false;
+  HashWith(transform, reinterpret_cast<const uint8_t *>(MSG_448),
+           strlen(MSG_448), md);
+  if (memcmp(md, MD_448, OUTPUT_SIZE) != 0) return false;
+
+  // Multi-block input must agree with the portable kernel.
+  uint8_t data[BLOCK_SIZE * 5 + 7];
+  for (size_t i = 0; i < sizeof(data); ++i) data[i] = i * 7 + 1;
+  uint8_t md_portable[OUTPUT_SIZE];
+  HashWith(transform, data, sizeof(data), md);
+  HashWith(TransformPortable, data, sizeof(data), md_portable);
+  return memcmp(md, md_portable, OUTPUT_SIZE) == 0;
+}
+
+/// Check a multi-lane kernel against the portable kernel lane by lane.
+static bool SelfTestLanes(TransformLanesFunc transform_n, size_t width) {
+  const size_t MAX_LANES = 8;
+  uint8_t data[MAX_LANES][BLOCK_SIZE];
+  uint32_t s[MAX_LANES][8];
+  uint32_t *states[MAX_LANES];
+  const uint8_t *blocks[MAX_LANES];
+  for (size_t k = 0; k < width; ++k) {
+    for (size_t i = 0; i < BLOCK_SIZE; ++i) data[k][i] = i * 7 + k * 13 + 1;
+    memcpy(s[k], IV, sizeof(s[k]));
+    s[k][k % 8] ^= k;
+    states[k] = s[k];
+    blocks[k] = data[k];
+  }
+  transform_n(states, blocks);
+  for (size_t k = 0; k < width; ++k) {
+    uint32_t expected[8];
+    memcpy(expected, IV, sizeof(expected));
+    expected[k % 8] ^= k;
+    TransformPortable(expected, data[k], 1);
+    if (memcmp(expected, s[k], sizeof(expected)) != 0) return false;
+  }
+  return true;
+}
+
+struct Backend {
+  const char *name;
+  TransformFunc transform;
+  TransformLanesFunc transform_4;  // Optional.
+  TransformLanesFunc transform_8;  // Optional.
+};
+
+static Backend SelectBackend() {
+  Backend backend = {"portable", TransformPortable, nullptr, nullptr};
+#ifdef SYSUTILS_X86_KERNELS
+  const sysutils::CpuFeatures &features = sysutils::GetCpuFeatures();
+  if (features.sha && SelfTest(TransformSHANI)) {
+    // One SHA-NI lane outruns the SSE4.1 and AVX2 lanes combined.
+    backend.name = "shani";
+    backend.transform = TransformSHANI;
+    return backend;
+  }
+  if (features.sse41 && features.ssse3 && SelfTestLanes(TransformSSE41x4, 4)) {
+    backend.name = "portable+sse41x4";
+    backend.transform_4 = TransformSSE41x4;
+  }
+  if (features.avx2 && SelfTestLanes(TransformAVX2x8, 8)) {
+    backend.name = backend.transform_4 ? "portable+avx2x8+sse41x4"
+                                       : "portable+avx2x8";
+    backend.transform_8 = TransformAVX2x8;
+  }
+#endif
+  return backend;
+}
+
+static const Backend &GetBackend() {
+  static const Backend backend = SelectBackend();
+  return backend;
+}
+
+void Transform(uint32_t *s, const uint8_t *blocks, size_t n) {
+  GetBackend().transform(s, blocks, n);
+}
+
+const char *GetImplementation() { return GetBackend().name; }
+
+size_t GetLanes() {
+  const Backend &backend = GetBackend();
+  if (backend.transform_8) return 8;
+  if (backend.transform_4) return 4;
+  return 1;
+}
+
+void Hash64(const uint8_t *in, uint8_t *md, size_t n) {
+  // Padding block of a 64-byte message: 0x80, zeros, 512 in bits.
+  static const uint8_t PAD_64[BLOCK_SIZE] = {
+      0x80, 0, 0, 0, 0, 0, 0,    0,
+      0,    0, 0, 0, 0, 0, 0,    0,
+      0,    0, 0, 0, 0, 0, 0,    0,
+      0,    0, 0, 0, 0, 0, 0,    0,
+      0,    0, 0, 0, 0, 0, 0,    0,
+      0,    0, 0, 0, 0, 0, 0,    0,
+      0,    0, 0, 0, 0, 0, 0,    0,
+      0,    0, 0, 0, 0, 0, 0x02, 0x00};
+  const size_t MAX_LANES = 8;
+  const Backend &backend = GetBackend();
+  uint32_t s[MAX_LANES][8];
+  uint32_t *states[MAX_LANES];
+  const uint8_t *blocks[MAX_LANES];
+  const uint8_t *pads[MAX_LANES];
+  for (size_t k = 0; k < MAX_LANES; ++k) {
+    states[k] = s[k];
+    pads[k] = PAD_64;
+  }
+
+  while (n > 0) {
+    size_t width = 1;
+    TransformLanesFunc transform_n = nullptr;
+    if (n >= 8 && backend.transform_8) {
+      width = 8;
+      transform_n = backend.transform_8;
+    } else if (n >= 4 && backend.transform_4) {
+      width = 4;
+      transform_n = backend.transform_4;
+    }
+    for (size_t k = 0; k < width; ++k) {
+      memcpy(s[k], IV, sizeof(s[k]));
+      blocks[k] = in + k * BLOCK_SIZE;
+    }
+    if (transform_n) {
+      transform_n(states, blocks);
+      transform_n(states, pads);
+    } else {
+      backend.transform(s[0], in, 1);
+      backend.transform(s[0], PAD_64, 1);
+    }
+    for (size_t k = 0; k < width; ++k) {
+      for (int i = 0; i < 8; ++i) WriteBE32(md + i * 4, s[k][i]);
+      md += OUTPUT_SIZE;
+    }
+    in += width * BLOCK_SIZE;
+    n -= width;
+  }
+}
+
+void HashMany(const uint8_t *const *data, const size_t *sizes, size_t count,
+              uint8_t *md) {
+  const Backend &backend = GetBackend();
+  if (GetLanes() == 1) {
+    for (size_t i = 0; i < count; ++i) {
+      HashWith(backend.transform, data[i], sizes[i], md + i * OUTPUT_SIZE);
+    }
+    return;
+  }
+
+  // Similar sizes next to each other, so lanes of a group finish together.
+  std::vector<size_t> order(count);
+  for (size_t i = 0; i < count; ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [sizes](size_t a, size_t b) {
+    return sizes[a] / BLOCK_SIZE < sizes[b] / BLOCK_SIZE;
+  });
+
+  size_t i = 0;
+  while (i < count) {
+    size_t rest = count - i;
+    if (rest >= 8 && backend.transform_8) {
+      HashLanes(backend.transform, backend.transform_8, 8, data, sizes,
+                order.data() + i, md);
+      i += 8;
+    } else if (rest >= 4 && backend.transform_4) {
+      HashLanes(backend.transform, backend.transform_4, 4, data, sizes,
+                order.data() + i, md);
+      i += 4;
+    } else {
+      HashWith(backend.transform, data[order[i]], sizes[order[i]],
+               md + order[i] * OUTPUT_SIZE);
+      ++i;
+    }
+  }
+}
+
+void Init(Context &ctx) {
+  memcpy(ctx.s, IV, sizeof(ctx.s));
+  ctx.bytes = 0;
+}
+
+void Update(Context &ctx, const uint8_t *p, size_t size) {
+  TransformFunc transform = GetBackend().transform;
+  size_t used = ctx.bytes % BLOCK_SIZE;
+  ctx.bytes += size;
+  if (used > 0) {
+    size_t fill = BLOCK_SIZE - used;
+    if (size < fill) {
+      memcpy(ctx.buf + used, p, size);
+      return;
+    }
+    memcpy(ctx.buf + used, p, fill);
+    transform(ctx.s, ctx.buf, 1);
+    p += fill;
+    size -= fill;
+  }
+  size_t full = size / BLOCK_SIZE;
+  if (full > 0) {
+    transform(ctx.s, p, full);
+    p += full * BLOCK_SIZE;
+    size -= full * BLOCK_SIZE;
+  }
+  memcpy(ctx.buf, p, size);
+}
+
+void Final(Context &ctx, uint8_t *md) {
+  static const uint8_t PAD[BLOCK_SIZE] = {0x80};
+  uint64_t bits = ctx.bytes << 3;
+  uint8_t len[8];
+  WriteBE32(len, bits >> 32);
+  WriteBE32(len + 4, bits);
+  size_t used = ctx.bytes % BLOCK_SIZE;
+  size_t pad = used < BLOCK_SIZE - 8 ? BLOCK_SIZE - 8 - used
+                                     : BLOCK_SIZE * 2 - 8 - used;
+  Update(ctx, PAD, pad);
+  Update(ctx, len, sizeof(len));
+  for (int i = 0; i < 8; ++i) WriteBE32(md + i * 4, ctx.s[i]);
+}
+
+}  // namespace sha256
+}  // namespace coin
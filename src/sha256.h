@@ -0,0 +1,98 @@
+#ifndef __SHA256_H__
+#define __SHA256_H__
+
+#include <cstddef>
+#include <cstdint>
+
+#include "sysutils.h"
+
+namespace coin {
+namespace sha256 {
+
+const size_t BLOCK_SIZE = 64;
+const size_t OUTPUT_SIZE = 32;
+
+/// State of a partially absorbed message.
+struct Context {
+  uint32_t s[8];
+  uint8_t buf[BLOCK_SIZE];
+  uint64_t bytes;
+};
+
+/// Reset context to the SHA-256 initial state.
+void Init(Context &ctx);
+
+/// Absorb `size` bytes.
+void Update(Context &ctx, const uint8_t *p, size_t size);
+
+/// Pad, finish and write OUTPUT_SIZE bytes to md.
+void Final(Context &ctx, uint8_t *md);
+
+/**
+ * Run the compression function over complete blocks.
+ *
+ * The kernel is chosen on the first call from the CPU features and has to
+ * pass a self-test before it is used, otherwise the portable kernel is used.
+ *
+ * @param s State words.
+ * @param blocks Message blocks, BLOCK_SIZE bytes each.
+ * @param n Number of blocks.
+ */
+void Transform(uint32_t *s, const uint8_t *blocks, size_t n);
+
+/**
+ * Hash independent messages, several at a time.
+ *
+ * Messages of similar block count are grouped and compressed in lockstep on
+ * the multi-lane kernel (AVX2 8 lanes, SSE4.1 4 lanes). CPUs with SHA
+ * extensions run every message on the single-lane kernel instead, which is
+ * faster there.
+ *
+ * @param data Messages.
+ * @param sizes Size of each message.
+ * @param count Number of messages.
+ * @param md Output, OUTPUT_SIZE bytes for each message.
+ */
+void HashMany(const uint8_t *const *data, const size_t *sizes, size_t count,
+              uint8_t *md);
+
+/**
+ * Hash inputs of exactly 64 bytes.
+ *
+ * The padding block of a 64-byte message is constant and precomputed, and
+ * inputs are compressed in lockstep on the multi-lane kernels.
+ *
+ * @param in `n` consecutive inputs of 64 bytes.
+ * @param md Output, `n` consecutive hash values of OUTPUT_SIZE bytes.
+ * @param n Number of inputs.
+ */
+void Hash64(const uint8_t *in, uint8_t *md, size_t n);
+
+/// Number of messages HashMany compresses in lockstep.
+size_t GetLanes();
+
+/// Name of the selected kernels, e.g. "shani" or "portable+avx2x8".
+const char *GetImplementation();
+
+/// Compression kernel signature.
+typedef void (*TransformFunc)(uint32_t *s, const uint8_t *blocks, size_t n);
+
+/// Multi-lane kernel signature, compresses one block into each lane state.
+typedef void (*TransformLanesFunc)(uint32_t *const *s,
+                                   const uint8_t *const *blocks);
+
+/// Round constants.
+extern const uint32_t K[64];
+
+/// Kernels, use Transform() or HashMany() instead of calling them directly.
+void TransformPortable(uint32_t *s, const uint8_t *blocks, size_t n);
+#ifdef SYSUTILS_X86_KERNELS
+void TransformSHANI(uint32_t *s, const uint8_t *blocks, size_t n);
+void TransformSSE41x4(uint32_t *const *s, const uint8_t *const *blocks);
+void TransformAVX2x8(uint32_t *const *s, const uint8_t *const *blocks);
+#endif
+
+}  // namespace sha256
+}  // namespace coin
+
+#endif
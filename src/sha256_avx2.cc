@@ -0,0 +1,125 @@
+#include "sha256.h"
+
+#ifdef SYSUTILS_X86_KERNELS
+
+#include <immintrin.h>
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+namespace coin {
+namespace sha256 {
+
+AVX2_TARGET static inline __m256i Add(__m256i a, __m256i b) {
+  return _mm256_add_epi32(a, b);
+}
+
+AVX2_TARGET static inline __m256i Rotr(__m256i x, int n) {
+  return _mm256_or_si256(_mm256_srli_epi32(x, n),
+                         _mm256_slli_epi32(x, 32 - n));
+}
+
+AVX2_TARGET static inline void Transpose(__m128i &r0, __m128i &r1,
+                                         __m128i &r2, __m128i &r3) {
+  __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+  __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+  __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+  __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+  r0 = _mm_unpacklo_epi64(t0, t1);
+  r1 = _mm_unpackhi_epi64(t0, t1);
+  r2 = _mm_unpacklo_epi64(t2, t3);
+  r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+AVX2_TARGET static inline __m256i Combine(__m128i lo, __m128i hi) {
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+/// Gather four consecutive words at byte `offset` from 8 lanes.
+AVX2_TARGET static inline void LoadWords(const uint8_t *const *p,
+                                         size_t offset, bool big_endian,
+                                         __m256i *out) {
+  const __m128i MASK =
+      _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  __m128i r[8];
+  for (int i = 0; i < 8; ++i) {
+    r[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p[i] + offset));
+    if (big_endian) r[i] = _mm_shuffle_epi8(r[i], MASK);
+  }
+  Transpose(r[0], r[1], r[2], r[3]);
+  Transpose(r[4], r[5], r[6], r[7]);
+  for (int j = 0; j < 4; ++j) out[j] = Combine(r[j], r[j + 4]);
+}
+
+AVX2_TARGET void TransformAVX2x8(uint32_t *const *s,
+                                 const uint8_t *const *blocks) {
+  // Word j of every lane is kept in one register, lane i in element i.
+  __m256i w[16];
+  for (int j = 0; j < 16; j += 4) LoadWords(blocks, j * 4, true, w + j);
+
+  const uint8_t *state[8];
+  for (int i = 0; i < 8; ++i) {
+    state[i] = reinterpret_cast<const uint8_t *>(s[i]);
+  }
+  __m256i v[8];
+  LoadWords(state, 0, false, v);
+  LoadWords(state, 16, false, v + 4);
+
+  __m256i a = v[0], b = v[1], c = v[2], d = v[3];
+  __m256i e = v[4], f = v[5], g = v[6], h = v[7];
+  for (int i = 0; i < 64; ++i) {
+    if (i >= 16) {
+      __m256i w15 = w[(i + 1) & 15], w2 = w[(i + 14) & 15];
+      __m256i s0 =
+          _mm256_xor_si256(_mm256_xor_si256(Rotr(w15, 7), Rotr(w15, 18)),
+                           _mm256_srli_epi32(w15, 3));
+      __m256i s1 =
+          _mm256_xor_si256(_mm256_xor_si256(Rotr(w2, 17), Rotr(w2, 19)),
+                           _mm256_srli_epi32(w2, 10));
+      w[i & 15] = Add(Add(w[i & 15], s0), Add(w[(i + 9) & 15], s1));
+    }
+    __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(Rotr(e, 6), Rotr(e, 11)),
+                                  Rotr(e, 25));
+    __m256i ch =
+        _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+    __m256i t1 = Add(Add(Add(h, s1), Add(ch, w[i & 15])),
+                     _mm256_set1_epi32(static_cast<int>(K[i])));
+    __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(Rotr(a, 2), Rotr(a, 13)),
+                                  Rotr(a, 22));
+    __m256i maj = _mm256_or_si256(
+        _mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+    h = g;
+    g = f;
+    f = e;
+    e = Add(d, t1);
+    d = c;
+    c = b;
+    b = a;
+    a = Add(t1, Add(s0, maj));
+  }
+
+  v[0] = Add(v[0], a);
+  v[1] = Add(v[1], b);
+  v[2] = Add(v[2], c);
+  v[3] = Add(v[3], d);
+  v[4] = Add(v[4], e);
+  v[5] = Add(v[5], f);
+  v[6] = Add(v[6], g);
+  v[7] = Add(v[7], h);
+  for (int j = 0; j < 8; j += 4) {
+    __m128i r[8];
+    for (int k = 0; k < 4; ++k) {
+      r[k] = _mm256_castsi256_si128(v[j + k]);
+      r[k + 4] = _mm256_extracti128_si256(v[j + k], 1);
+    }
+    Transpose(r[0], r[1], r[2], r[3]);
+    Transpose(r[4], r[5], r[6], r[7]);
+    for (int i = 0; i < 8; ++i) {
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(s[i] + j), r[i]);
+    }
+  }
+}
+
+}  // namespace sha256
+}  // namespace coin
+
+#endif
@@ -0,0 +1,62 @@
+#include "sha256.h"
+
+#ifdef SYSUTILS_X86_KERNELS
+
+#include <immintrin.h>
+
+namespace coin {
+namespace sha256 {
+
+__attribute__((target("sha,sse4.1,ssse3"))) void TransformSHANI(
+    uint32_t *s, const uint8_t *blocks, size_t n) {
+  const __m128i MASK =
+      _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+  // Rearrange state words into the ABEF/CDGH layout of sha256rnds2.
+  __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s));
+  __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 4));
+  tmp = _mm_shuffle_epi32(tmp, 0xB1);           // CDAB
+  state1 = _mm_shuffle_epi32(state1, 0x1B);     // EFGH
+  __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);  // ABEF
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0);  // CDGH
+
+  while (n--) {
+    __m128i abef = state0;
+    __m128i cdgh = state1;
+    // w[i & 3] holds the four message words of round group i.
+    __m128i w[4];
+    for (int i = 0; i < 16; ++i) {
+      if (i < 4) {
+        w[i] = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(blocks) + i),
+            MASK);
+      } else {
+        __m128i w4 = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+        w4 = _mm_add_epi32(w4, _mm_alignr_epi8(w[(i + 3) & 3],
+                                               w[(i + 2) & 3], 4));
+        w[i & 3] = _mm_sha256msg2_epu32(w4, w[(i + 3) & 3]);
+      }
+      __m128i msg = _mm_add_epi32(
+          w[i & 3], _mm_loadu_si128(reinterpret_cast<const __m128i *>(K) + i));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      msg = _mm_shuffle_epi32(msg, 0x0E);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+    }
+    state0 = _mm_add_epi32(state0, abef);
+    state1 = _mm_add_epi32(state1, cdgh);
+    blocks += BLOCK_SIZE;
+  }
+
+  // Back to ABCD/EFGH.
+  tmp = _mm_shuffle_epi32(state0, 0x1B);        // FEBA
+  state1 = _mm_shuffle_epi32(state1, 0xB1);     // DCHG
+  state0 = _mm_blend_epi16(tmp, state1, 0xF0);  // DCBA
+  state1 = _mm_alignr_epi8(state1, tmp, 8);     // HGFE
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(s), state0);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(s + 4), state1);
+}
+
+}  // namespace sha256
+}  // namespace coin
+
+#endif
@@ -0,0 +1,108 @@
+#include "sha256.h"
+
+#ifdef SYSUTILS_X86_KERNELS
+
+#include <immintrin.h>
+
+#define SSE41_TARGET __attribute__((target("sse4.1,ssse3")))
+
+namespace coin {
+namespace sha256 {
+
+SSE41_TARGET static inline __m128i Add(__m128i a, __m128i b) {
+  return _mm_add_epi32(a, b);
+}
+
+SSE41_TARGET static inline __m128i Rotr(__m128i x, int n) {
+  return _mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - n));
+}
+
+SSE41_TARGET static inline void Transpose(__m128i &r0, __m128i &r1,
+                                          __m128i &r2, __m128i &r3) {
+  __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+  __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+  __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+  __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+  r0 = _mm_unpacklo_epi64(t0, t1);
+  r1 = _mm_unpackhi_epi64(t0, t1);
+  r2 = _mm_unpacklo_epi64(t2, t3);
+  r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+SSE41_TARGET static inline __m128i LoadBE(const uint8_t *p) {
+  const __m128i MASK =
+      _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  return _mm_shuffle_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), MASK);
+}
+
+SSE41_TARGET void TransformSSE41x4(uint32_t *const *s,
+                                   const uint8_t *const *blocks) {
+  // Word j of every lane is kept in one register, lane i in element i.
+  __m128i w[16];
+  for (int j = 0; j < 16; j += 4) {
+    w[j] = LoadBE(blocks[0] + j * 4);
+    w[j + 1] = LoadBE(blocks[1] + j * 4);
+    w[j + 2] = LoadBE(blocks[2] + j * 4);
+    w[j + 3] = LoadBE(blocks[3] + j * 4);
+    Transpose(w[j], w[j + 1], w[j + 2], w[j + 3]);
+  }
+
+  __m128i v[8];
+  for (int j = 0; j < 8; j += 4) {
+    for (int i = 0; i < 4; ++i) {
+      v[j + i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s[i] + j));
+    }
+    Transpose(v[j], v[j + 1], v[j + 2], v[j + 3]);
+  }
+
+  __m128i a = v[0], b = v[1], c = v[2], d = v[3];
+  __m128i e = v[4], f = v[5], g = v[6], h = v[7];
+  for (int i = 0; i < 64; ++i) {
+    if (i >= 16) {
+      __m128i w15 = w[(i + 1) & 15], w2 = w[(i + 14) & 15];
+      __m128i s0 = _mm_xor_si128(_mm_xor_si128(Rotr(w15, 7), Rotr(w15, 18)),
+                                 _mm_srli_epi32(w15, 3));
+      __m128i s1 = _mm_xor_si128(_mm_xor_si128(Rotr(w2, 17), Rotr(w2, 19)),
+                                 _mm_srli_epi32(w2, 10));
+      w[i & 15] = Add(Add(w[i & 15], s0), Add(w[(i + 9) & 15], s1));
+    }
+    __m128i s1 =
+        _mm_xor_si128(_mm_xor_si128(Rotr(e, 6), Rotr(e, 11)), Rotr(e, 25));
+    __m128i ch = _mm_xor_si128(_mm_and_si128(e, f), _mm_andnot_si128(e, g));
+    __m128i t1 = Add(Add(Add(h, s1), Add(ch, w[i & 15])),
+                     _mm_set1_epi32(static_cast<int>(K[i])));
+    __m128i s0 =
+        _mm_xor_si128(_mm_xor_si128(Rotr(a, 2), Rotr(a, 13)), Rotr(a, 22));
+    __m128i maj = _mm_or_si128(_mm_and_si128(a, b),
+                               _mm_and_si128(c, _mm_or_si128(a, b)));
+    h = g;
+    g = f;
+    f = e;
+    e = Add(d, t1);
+    d = c;
+    c = b;
+    b = a;
+    a = Add(t1, Add(s0, maj));
+  }
+
+  v[0] = Add(v[0], a);
+  v[1] = Add(v[1], b);
+  v[2] = Add(v[2], c);
+  v[3] = Add(v[3], d);
+  v[4] = Add(v[4], e);
+  v[5] = Add(v[5], f);
+  v[6] = Add(v[6], g);
+  v[7] = Add(v[7], h);
+  for (int j = 0; j < 8; j += 4) {
+    Transpose(v[j], v[j + 1], v[j + 2], v[j + 3]);
+    for (int i = 0; i < 4; ++i) {
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(s[i] + j), v[j + i]);
+    }
+  }
+}
+
+}  // namespace sha256
+}  // namespace coin
+
+#endif
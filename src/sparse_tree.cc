@@ -0,0 +1,293 @@
+#include "sparse_tree.h"
+
+#include <algorithm>
+
+namespace coin {
+namespace mt {
+
+/// Leaf hash values are prefixed, so a leaf never hashes like a node.
+static const uint8_t LEAF_PREFIX = 0x00;
+
+/// Hash values of empty subtrees for heights 0 (empty leaf) to SPARSE_DEPTH.
+struct DefaultHashes {
+  uint8_t hashes[SPARSE_DEPTH + 1][HASH_SIZE];
+
+  explicit DefaultHashes(NodeHashMode mode) {
+    memset(hashes[0], 0, HASH_SIZE);
+    for (size_t h = 1; h <= SPARSE_DEPTH; ++h) {
+      HashNode(hashes[h - 1], hashes[h - 1], hashes[h], mode);
+    }
+  }
+};
+
+/// Default hash values of a node hash mode.
+static const uint8_t (*GetDefaultHashes(NodeHashMode mode))[HASH_SIZE] {
+  if (mode == NodeHashMode::Hash64) {
+    static const DefaultHashes hash64_defaults(NodeHashMode::Hash64);
+    return hash64_defaults.hashes;
+  }
+  static const DefaultHashes builder_defaults(NodeHashMode::Builder);
+  return builder_defaults.hashes;
+}
+
+/// Bit `bit` of key, counted from the least significant bit.
+static bool GetBit(const bn::HashNum &key, size_t bit) {
+  return (key.get_data()[31 - bit / 8] >> (bit % 8)) & 1;
+}
+
+static void FlipBit(bn::HashNum &key, size_t bit) {
+  key.get_data()[31 - bit / 8] ^= 1 << (bit % 8);
+}
+
+/// Clear the low `bits` bits of key.
+static void ClearLowBits(bn::HashNum &key, size_t bits) {
+  uint8_t *data = key.get_data();
+  size_t bytes = bits / 8;
+  memset(data + 32 - bytes, 0, bytes);
+  if (bits % 8 != 0) data[31 - bytes] &= 0xff << (bits % 8);
+}
+
+/// Key with its low `bits` bits cleared, the prefix of a node at that height.
+static bn::HashNum MakePrefix(const bn::HashNum &key, size_t bits) {
+  bn::HashNum prefix = key;
+  ClearLowBits(prefix, bits);
+  return prefix;
+}
+
+/// Index of the highest bit where two different keys differ.
+static size_t HighestDifferentBit(const bn::HashNum &a, const bn::HashNum &b) {
+  for (size_t i = 0; i < HASH_SIZE; ++i) {
+    unsigned int x = a.get_data()[i] ^ b.get_data()[i];
+    if (x != 0) return (31 - i) * 8 + (31 - __builtin_clz(x));
+  }
+  assert(false && "Same keys");
+  return 0;
+}
+
+size_t SparseTree::KeyHasher::operator()(const NodeId &id) const {
+  // Keys are hash values, so are prefixes, the leading bytes are uniform.
+  size_t value;
+  memcpy(&value, id.prefix.get_data(), sizeof(value));
+  return value ^ (id.height * 0x9e3779b97f4a7c15ull);
+}
+
+SparseTree::SparseTree(NodeHashMode mode)
+    : mode_(mode), defaults_(GetDefaultHashes(mode)) {
+  memcpy(root_.data, defaults_[SPARSE_DEPTH], HASH_SIZE);
+}
+
+void SparseTree::Apply(const std::vector<Update> &updates) {
+  std::vector<bn::HashNum> keys;
+  keys.reserve(updates.size());
+  for (const Update &update : updates) {
+    const bn::HashNum &key = update.first;
+    const std::vector<uint8_t> &value = update.second.value;
+    if (value.empty()) {
+      values_.erase(key);
+    } else {
+      assert(value.size() == HASH_SIZE);
+      memcpy(values_[key].data, value.data(), HASH_SIZE);
+    }
+    keys.push_back(key);
+  }
+  RehashPaths(std::move(keys));
+}
+
+void SparseTree::Set(const bn::HashNum &key, const uint8_t *value) {
+  data::Buffer buffer;
+  buffer.CopyFrom(value, HASH_SIZE);
+  Apply({Update(key, buffer)});
+}
+
+void SparseTree::Remove(const bn::HashNum &key) {
+  Apply({Update(key, data::Buffer())});
+}
+
+bool SparseTree::Get(const bn::HashNum &key, uint8_t *value) const {
+  auto it = values_.find(key);
+  if (it == values_.end()) return false;
+  memcpy(value, it->second.data, HASH_SIZE);
+  return true;
+}
+
+data::Buffer SparseTree::Root() const {
+  data::Buffer root;
+  root.CopyFrom(GetRoot(), HASH_SIZE);
+  return root;
+}
+
+void SparseTree::MakeProof(const bn::HashNum &key, SparseProof &proof) const {
+  memset(proof.bitmap, 0, sizeof(proof.bitmap));
+  proof.siblings.clear();
+  for (size_t h = 0; h < SPARSE_DEPTH; ++h) {
+    bn::HashNum sibling = MakePrefix(key, h);
+    FlipBit(sibling, h);
+    int count = CountKeys(h, sibling);
+    if (count == 0) continue;
+    proof.bitmap[h / 8] |= 1 << (h % 8);
+    size_t offset = proof.siblings.size();
+    proof.siblings.resize(offset + HASH_SIZE);
+    GetNode(h, sibling, count, proof.siblings.data() + offset);
+  }
+}
+
+void SparseTree::HashLeaf(const bn::HashNum &key, const uint8_t *value,
+                          uint8_t *out) {
+  Hash256 algo;
+  algo.Calculate(&LEAF_PREFIX, sizeof(LEAF_PREFIX));
+  algo.Calculate(key.get_data(), HASH_SIZE);
+  algo.Calculate(value, HASH_SIZE);
+  algo.Final();
+  memcpy(out, algo.get_md(), HASH_SIZE);
+}
+
+int SparseTree::CountKeys(size_t height, const bn::HashNum &prefix) const {
+  auto it = values_.lower_bound(prefix);
+  if (it == values_.end() || MakePrefix(it->first, height) != prefix) {
+    return 0;
+  }
+  ++it;
+  if (it == values_.end() || MakePrefix(it->first, height) != prefix) {
+    return 1;
+  }
+  return 2;
+}
+
+void SparseTree::GetNode(size_t height, const bn::HashNum &prefix, int count,
+                         uint8_t *out) const {
+  if (count == 0) {
+    memcpy(out, defaults_[height], HASH_SIZE);
+    return;
+  }
+  auto it = nodes_.find(NodeId{static_cast<uint16_t>(height), prefix});
+  if (it != nodes_.end()) {
+    memcpy(out, it->second.data, HASH_SIZE);
+    return;
+  }
+  // Nodes with two or more keys are always stored, fold the single key.
+  assert(count == 1);
+  auto value = values_.lower_bound(prefix);
+  HashLeaf(value->first, value->second.data, out);
+  for (size_t h = 0; h < height; ++h) {
+    if (GetBit(value->first, h)) {
+      HashNode(defaults_[h], out, out, mode_);
+    } else {
+      HashNode(out, defaults_[h], out, mode_);
+    }
+  }
+}
+
+void SparseTree::RehashPaths(std::vector<bn::HashNum> keys) {
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  if (keys.empty()) return;
+
+  // Changed nodes of the current level: prefixes, key counts and hashes.
+  std::vector<int> counts(keys.size());
+  std::vector<uint8_t> hashes(keys.size() * HASH_SIZE);
+  // Below its branch height, the siblings on the path of a key are empty.
+  std::vector<size_t> branches(keys.size(), SPARSE_DEPTH);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    counts[i] = CountKeys(0, keys[i]);
+    GetNode(0, keys[i], counts[i], hashes.data() + i * HASH_SIZE);
+    // The longest common prefix is shared with a neighbour in key order.
+    auto it = values_.lower_bound(keys[i]);
+    if (it != values_.end() && it->first == keys[i]) ++it;
+    if (it != values_.end()) {
+      branches[i] = HighestDifferentBit(keys[i], it->first);
+    }
+    it = values_.lower_bound(keys[i]);
+    if (it != values_.begin()) {
+      branches[i] =
+          std::min(branches[i], HighestDifferentBit(keys[i], (--it)->first));
+    }
+  }
+
+  std::vector<bn::HashNum> parents;
+  std::vector<int> parent_counts;
+  std::vector<size_t> parent_branches;
+  std::vector<uint8_t> children, parent_hashes;
+  for (size_t h = 1; h <= SPARSE_DEPTH; ++h) {
+    parents.clear();
+    parent_counts.clear();
+    parent_branches.clear();
+    children.resize(keys.size() * 2 * HASH_SIZE);
+    size_t i = 0;
+    while (i < keys.size()) {
+      bn::HashNum child_prefix[2] = {MakePrefix(keys[i], h),
+                                     MakePrefix(keys[i], h)};
+      FlipBit(child_prefix[1], h - 1);
+      uint8_t *child = children.data() + parents.size() * 2 * HASH_SIZE;
+      int child_count[2];
+      size_t branch = branches[i];
+      for (int c = 0; c < 2; ++c) {
+        if (i < keys.size() && keys[i] == child_prefix[c]) {
+          memcpy(child + c * HASH_SIZE, hashes.data() + i * HASH_SIZE,
+                 HASH_SIZE);
+          child_count[c] = counts[i++];
+        } else if (h - 1 < branch) {
+          memcpy(child + c * HASH_SIZE, defaults_[h - 1], HASH_SIZE);
+          child_count[c] = 0;
+        } else {
+          child_count[c] = CountKeys(h - 1, child_prefix[c]);
+          GetNode(h - 1, child_prefix[c], child_count[c],
+                  child + c * HASH_SIZE);
+        }
+      }
+      int count = std::min(child_count[0] + child_count[1], 2);
+
+      // Store non-empty children of nodes with two or more keys only.
+      for (int c = 0; c < 2; ++c) {
+        NodeId id{static_cast<uint16_t>(h - 1), child_prefix[c]};
+        if (count == 2 && child_count[c] > 0) {
+          memcpy(nodes_[id].data, child + c * HASH_SIZE, HASH_SIZE);
+        } else {
+          nodes_.erase(id);
+        }
+      }
+      parents.push_back(child_prefix[0]);
+      parent_counts.push_back(count);
+      parent_branches.push_back(branch);
+    }
+
+    parent_hashes.resize(parents.size() * HASH_SIZE);
+    HashNodes(children.data(), parents.size(), parent_hashes.data(), mode_);
+    keys.swap(parents);
+    counts.swap(parent_counts);
+    branches.swap(parent_branches);
+    hashes.swap(parent_hashes);
+  }
+  memcpy(root_.data, hashes.data(), HASH_SIZE);
+}
+
+bool VerifySparseProof(const bn::HashNum &key, const uint8_t *value,
+                       const SparseProof &proof, const uint8_t *root,
+                       NodeHashMode mode) {
+  if (proof.siblings.size() % HASH_SIZE != 0) return false;
+  const uint8_t(*defaults)[HASH_SIZE] = GetDefaultHashes(mode);
+  uint8_t hash[HASH_SIZE];
+  if (value != nullptr) {
+    SparseTree::HashLeaf(key, value, hash);
+  } else {
+    memcpy(hash, defaults[0], HASH_SIZE);
+  }
+  const uint8_t *sibling = proof.siblings.data();
+  const uint8_t *sibling_end = sibling + proof.siblings.size();
+  for (size_t h = 0; h < SPARSE_DEPTH; ++h) {
+    const uint8_t *other = defaults[h];
+    if ((proof.bitmap[h / 8] >> (h % 8)) & 1) {
+      if (sibling == sibling_end) return false;
+      other = sibling;
+      sibling += HASH_SIZE;
+    }
+    if (GetBit(key, h)) {
+      HashNode(other, hash, hash, mode);
+    } else {
+      HashNode(hash, other, hash, mode);
+    }
+  }
+  return sibling == sibling_end && memcmp(hash, root, HASH_SIZE) == 0;
+}
+
+}  // namespace mt
+}  // namespace coin
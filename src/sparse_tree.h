@@ -0,0 +1,192 @@
+#ifndef __SPARSE_TREE_H__
+#define __SPARSE_TREE_H__
+
+#include <cstdint>
+
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "big_num.h"
+#include "data_value.h"
+#include "merkle_tree.h"
+
+namespace coin {
+namespace mt {
+
+/// Number of levels below the root of a sparse tree, one per key bit.
+const size_t SPARSE_DEPTH = 256;
+
+/**
+ * Inclusion or exclusion proof of a key in a SparseTree.
+ *
+ * Siblings equal to the hash value of an empty subtree are left out, bit `h`
+ * of `bitmap` is set when the sibling at height `h` is present. Siblings are
+ * ordered from the leaf up.
+ */
+struct SparseProof {
+  uint8_t bitmap[SPARSE_DEPTH / 8];
+  std::vector<uint8_t> siblings;
+
+  size_t num_siblings() const { return siblings.size() / HASH_SIZE; }
+
+  /// Bytes written by Serialize().
+  size_t GetSerializedSize() const {
+    return sizeof(bitmap) + sizeof(uint16_t) + siblings.size();
+  }
+
+  template <typename Stream>
+  void Serialize(Stream &s) const {
+    s.write(reinterpret_cast<const char *>(bitmap), sizeof(bitmap));
+    data::MakeValue(static_cast<uint16_t>(num_siblings())).WriteToStream(s);
+    s.write(reinterpret_cast<const char *>(siblings.data()), siblings.size());
+  }
+
+  template <typename Stream>
+  void Unserialize(Stream &s) {
+    s.read(reinterpret_cast<char *>(bitmap), sizeof(bitmap));
+    size_t n = data::ReadValue<uint16_t>(s);
+    // Untrusted input, VerifySparseProof() fails on a wrong count.
+    if (n > SPARSE_DEPTH) n = SPARSE_DEPTH;
+    siblings.resize(n * HASH_SIZE);
+    s.read(reinterpret_cast<char *>(siblings.data()), siblings.size());
+  }
+};
+
+/**
+ * Sparse merkle tree, an authenticated map of 256-bit keys to 32-byte
+ * values, e.g. the hash values of unspent outputs.
+ *
+ * Every key has its leaf at depth 256, the path follows the key bits from
+ * the most significant one. Empty subtrees have precomputed default hash
+ * values and are never stored. Of the other nodes only those holding two or
+ * more keys and the top node of each single-key subtree are stored, O(n)
+ * nodes for n keys. The rest of a single-key path is folded from the leaf
+ * with the default hash values when needed. The root commits to the whole
+ * map.
+ */
+class SparseTree {
+ public:
+  /// Set the value of key, or remove it with an empty value.
+  typedef std::pair<bn::HashNum, data::Buffer> Update;
+
+  /// Create an empty tree hashing parent nodes with `mode`.
+  explicit SparseTree(NodeHashMode mode = NodeHashMode::Builder);
+
+  NodeHashMode get_node_hash_mode() const { return mode_; }
+
+  /**
+   * Apply updates and rehash.
+   *
+   * Paths shared by several keys are rehashed once, nodes of each level are
+   * hashed in one batch. Later updates of the same key win.
+   *
+   * @param updates Keys and values, HASH_SIZE bytes or empty to remove.
+   */
+  void Apply(const std::vector<Update> &updates);
+
+  /// Set the value of a key, HASH_SIZE bytes.
+  void Set(const bn::HashNum &key, const uint8_t *value);
+
+  /// Remove a key.
+  void Remove(const bn::HashNum &key);
+
+  /**
+   * Get the value of a key.
+   *
+   * @param key Key.
+   * @param value HASH_SIZE bytes output.
+   *
+   * @return False if the key is not present.
+   */
+  bool Get(const bn::HashNum &key, uint8_t *value) const;
+
+  /// Number of keys.
+  size_t size() const { return values_.size(); }
+
+  /// Number of stored nodes.
+  size_t node_count() const { return nodes_.size(); }
+
+  /// Root hash value, HASH_SIZE bytes.
+  const uint8_t *GetRoot() const { return root_.data; }
+
+  data::Buffer Root() const;
+
+  /**
+   * Make proof that a key is present with its value, or is absent.
+   *
+   * @param key Key.
+   * @param proof Output proof.
+   */
+  void MakeProof(const bn::HashNum &key, SparseProof &proof) const;
+
+  /// Hash value of a leaf holding `value` under `key`.
+  static void HashLeaf(const bn::HashNum &key, const uint8_t *value,
+                       uint8_t *out);
+
+ private:
+  struct Digest {
+    uint8_t data[HASH_SIZE];
+  };
+
+  /// Node at `height` above the leaves, key with its low `height` bits 0.
+  struct NodeId {
+    uint16_t height;
+    bn::HashNum prefix;
+
+    bool operator==(const NodeId &another) const {
+      return height == another.height && prefix == another.prefix;
+    }
+  };
+
+  struct KeyHasher {
+    size_t operator()(const NodeId &id) const;
+  };
+
+  /// Number of keys under a node, counting stops at 2.
+  int CountKeys(size_t height, const bn::HashNum &prefix) const;
+
+  /**
+   * Hash value of a node.
+   *
+   * @param height Height of the node.
+   * @param prefix Node prefix.
+   * @param count CountKeys() of the node.
+   * @param out HASH_SIZE bytes output.
+   */
+  void GetNode(size_t height, const bn::HashNum &prefix, int count,
+               uint8_t *out) const;
+
+  /// Rehash all nodes above the leaves of `keys`.
+  void RehashPaths(std::vector<bn::HashNum> keys);
+
+ private:
+  std::map<bn::HashNum, Digest> values_;
+  std::unordered_map<NodeId, Digest, KeyHasher> nodes_;
+  Digest root_;
+  NodeHashMode mode_;
+  /// Hash values of empty subtrees of each height, in mode_.
+  const uint8_t (*defaults_)[HASH_SIZE];
+};
+
+/**
+ * Verify a SparseProof.
+ *
+ * @param key Key.
+ * @param value Value of the key to prove it is present, nullptr to prove it
+ * is absent.
+ * @param proof Proof of the key.
+ * @param root Root hash value, HASH_SIZE bytes.
+ * @param mode Node hash mode of the tree.
+ *
+ * @return True if the proof and the value or absence rebuild root.
+ */
+bool VerifySparseProof(const bn::HashNum &key, const uint8_t *value,
+                       const SparseProof &proof, const uint8_t *root,
+                       NodeHashMode mode = NodeHashMode::Builder);
+
+}  // namespace mt
+}  // namespace coin
+
+#endif
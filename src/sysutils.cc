@@ -1,5 +1,9 @@
 #include "sysutils.h"
 
+#ifdef SYSUTILS_X86_KERNELS
+#include <cpuid.h>
+#endif
+
 namespace sysutils {
 
 static inline int64_t GetPerformanceCounter() {
@@ -24,4 +28,36 @@ static inline int64_t GetPerformanceCounter() {
 #endif
 }
 
+#ifdef SYSUTILS_X86_KERNELS
+static uint64_t ReadXCR0() {
+  uint32_t a, d;
+  __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+  return (static_cast<uint64_t>(d) << 32) | a;
+}
+#endif
+
+static CpuFeatures DetectCpuFeatures() {
+  CpuFeatures features;
+#ifdef SYSUTILS_X86_KERNELS
+  uint32_t eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return features;
+  features.ssse3 = (ecx >> 9) & 1;
+  features.sse41 = (ecx >> 19) & 1;
+  // AVX registers are usable only when the OS saves them (OSXSAVE + XCR0).
+  bool avx_os = ((ecx >> 27) & 1) && ((ecx >> 28) & 1) &&
+                (ReadXCR0() & 0x6) == 0x6;
+  if (__get_cpuid_max(0, nullptr) >= 7) {
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    features.avx2 = avx_os && ((ebx >> 5) & 1);
+    features.sha = features.sse41 && ((ebx >> 29) & 1);
+  }
+#endif
+  return features;
+}
+
+const CpuFeatures &GetCpuFeatures() {
+  static const CpuFeatures features = DetectCpuFeatures();
+  return features;
+}
+
 }  // namespace sysutils
@@ -3,10 +3,35 @@
 
 #include <cstdint>
 
+#if (defined(__x86_64__) || defined(__amd64__) || defined(__i386__)) && \
+    defined(__GNUC__)
+// x86 kernels are built with per-function target attributes, no global
+// compiler flags are required.
+#define SYSUTILS_X86_KERNELS 1
+#endif
+
 namespace sysutils {
 
 static inline int64_t GetPerformanceCounter();
 
+/// Instruction set extensions of the running CPU.
+struct CpuFeatures {
+  bool ssse3 = false;
+  bool sse41 = false;
+  bool avx2 = false;
+  bool sha = false;
+};
+
+/**
+ * Detect CPU features.
+ *
+ * CPUID is queried on the first call only, later calls return the cached
+ * result.
+ *
+ * @return Features supported by both the CPU and the operating system.
+ */
+const CpuFeatures &GetCpuFeatures();
+
 }  // namespace sysutils
 
 #endif
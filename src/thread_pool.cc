@@ -0,0 +1,71 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace coin {
+
+ThreadPool::ThreadPool(size_t num_threads) {
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (size_t i = 1; i < num_threads; ++i) {
+    workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  task_cv_.notify_all();
+  for (std::thread &worker : workers_) worker.join();
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain, const RangeFunc &fn) {
+  if (count == 0) return;
+  if (grain == 0) grain = 1;
+  size_t num_pieces = (count + grain - 1) / grain;
+  std::atomic<size_t> next(0);
+  auto run = [&]() {
+    size_t piece;
+    while ((piece = next.fetch_add(1)) < num_pieces) {
+      size_t begin = piece * grain;
+      fn(begin, std::min(begin + grain, count));
+    }
+  };
+
+  // Helpers count down `pending`, the caller waits for it after its share.
+  size_t pending = std::min(workers_.size(), num_pieces - 1);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0, n = pending; i < n; ++i) {
+      tasks_.emplace_back([this, &run, &pending]() {
+        run();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending == 0) done_cv_.notify_all();
+      });
+    }
+  }
+  task_cv_.notify_all();
+  run();
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [&pending]() { return pending == 0; });
+}
+
+void ThreadPool::WorkerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      task_cv_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+      if (tasks_.empty()) return;
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+}  // namespace coin
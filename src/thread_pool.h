@@ -0,0 +1,62 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace coin {
+
+/// Fixed set of worker threads for data-parallel loops.
+class ThreadPool {
+ public:
+  typedef std::function<void(size_t begin, size_t end)> RangeFunc;
+
+  /**
+   * Start worker threads.
+   *
+   * The thread calling ParallelFor() works too, so `num_threads - 1` workers
+   * are started.
+   *
+   * @param num_threads Number of threads, 0 for one per hardware thread.
+   */
+  explicit ThreadPool(size_t num_threads = 0);
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  ~ThreadPool();
+
+  /// Number of threads working on a loop, including the caller.
+  size_t get_num_threads() const { return workers_.size() + 1; }
+
+  /**
+   * Run `fn` over [0, count) and wait until it is done.
+   *
+   * The range is cut into pieces of `grain` items, threads take the next
+   * piece as soon as they finish one. Must not be called from inside `fn`.
+   *
+   * @param count Number of items.
+   * @param grain Items in each piece.
+   * @param fn Called with [begin, end) of each piece.
+   */
+  void ParallelFor(size_t count, size_t grain, const RangeFunc &fn);
+
+ private:
+  void WorkerLoop();
+
+ private:
+  std::vector<std::thread> workers_;
+  std::deque<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable task_cv_;
+  std::condition_variable done_cv_;
+  bool stop_ = false;
+};
+
+}  // namespace coin
+
+#endif
@@ -8,23 +8,120 @@ namespace tx {
 
 data::Buffer MakeTxSignature(const ecdsa::Key &key, const data::Buffer &tx_hash,
                              int out_index) {
-  // Hash with sha256 algorithm.
+  return MakeTxSignature(key, MakeTxSignatureMidstate(tx_hash), out_index);
+}
+
+Hash256 MakeTxSignatureMidstate(const data::Buffer &tx_hash) {
   Hash256Builder hash_builder;
-  hash_builder << tx_hash << data::MakeValue(out_index);
+  hash_builder << tx_hash;
+  return hash_builder.get_algo();
+}
+
+data::Buffer MakeTxSignature(const ecdsa::Key &key, const Hash256 &midstate,
+                             int out_index) {
+  // Hash with sha256 algorithm.
+  Hash256Builder hash_builder(midstate);
+  hash_builder << data::MakeValue(out_index);
   auto hash = hash_builder.FinalValue();
 
   // Make signature to hash value.
-  return key.Sign(hash.MakeStreamData());
+  return key.Sign(hash.value);
 }
 
 }  // namespace tx
 
+Transaction::Transaction(data::Arena *arena)
+    : pub_key_(data::ArenaBytes::allocator_type(arena)),
+      vec_txin(data::ArenaAllocator<TxIn>(arena)),
+      vec_txout(data::ArenaAllocator<TxOut>(arena)) {}
+
+Transaction::Transaction(const Transaction &another) { *this = another; }
+
+Transaction::Transaction(Transaction &&another)
+    : TransactionBase(another),
+      pub_key_(std::move(another.pub_key_)),
+      vec_txin(std::move(another.vec_txin)),
+      vec_txout(std::move(another.vec_txout)),
+      hash_cache_(std::move(another.hash_cache_)),
+      hash_valid_(another.hash_valid_.load(std::memory_order_relaxed)) {
+  another.hash_valid_.store(false, std::memory_order_relaxed);
+}
+
+Transaction &Transaction::operator=(const Transaction &another) {
+  if (this == &another) return *this;
+  // another may be calculating its hash value in a const call.
+  std::lock_guard<std::mutex> lock(another.hash_mutex_);
+  TransactionBase::operator=(another);
+  pub_key_ = another.pub_key_;
+  vec_txin = another.vec_txin;
+  vec_txout = another.vec_txout;
+  hash_cache_ = another.hash_cache_;
+  hash_valid_.store(another.hash_valid_.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+  return *this;
+}
+
+Transaction &Transaction::operator=(Transaction &&another) {
+  if (this == &another) return *this;
+  TransactionBase::operator=(another);
+  pub_key_ = std::move(another.pub_key_);
+  vec_txin = std::move(another.vec_txin);
+  vec_txout = std::move(another.vec_txout);
+  hash_cache_ = std::move(another.hash_cache_);
+  hash_valid_.store(another.hash_valid_.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+  another.hash_valid_.store(false, std::memory_order_relaxed);
+  return *this;
+}
+
 void Transaction::set_pub_key(const data::Buffer &pub_key) {
-  pub_key_ = pub_key;
+  pub_key_.value.assign(pub_key.value.begin(), pub_key.value.end());
+  hash_valid_.store(false, std::memory_order_relaxed);
+}
+
+void Transaction::add_tx_in(const TxIn &in) {
+  vec_txin.push_back(in);
+  hash_valid_.store(false, std::memory_order_relaxed);
+}
+
+void Transaction::add_tx_out(const TxOut &out) {
+  vec_txout.push_back(out);
+  hash_valid_.store(false, std::memory_order_relaxed);
+}
+
+size_t Transaction::GetSerializedSize(data::Format format) const {
+  size_t size =
+      sizeof(int) + sizeof(time_t) + pub_key_.GetSerializedSize(format);
+  // Merkle hash.
+  size += data::GetLengthSize(sizeof(bn::HashNum), format) +
+          sizeof(bn::HashNum);
+  size += data::GetVectorSize(vec_txin, format);
+  return size + data::GetVectorSize(vec_txout, format);
 }
 
-void Transaction::add_tx_in(const TxIn &in) { vec_txin.push_back(in); }
+const data::Buffer &Transaction::CalcHash() const {
+  if (!hash_valid_.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(hash_mutex_);
+    if (!hash_valid_.load(std::memory_order_relaxed)) {
+      hash_cache_ = CalcMerkleHash();
+      CacheHash(hash_cache_);
+      hash_valid_.store(true, std::memory_order_release);
+    }
+  }
+  return hash_cache_;
+}
 
-void Transaction::add_tx_out(const TxOut &out) { vec_txout.push_back(out); }
+data::Buffer Transaction::CalcMerkleHash() const {
+  auto txin_root = mt::MakeMerkleTree(vec_txin);    // TxIn
+  auto txout_root = mt::MakeMerkleTree(vec_txout);  // TxOut
+  Hash256Builder hash_builder;
+  if (txin_root) {
+    hash_builder << txin_root->get_hash();
+  }
+  if (txout_root) {
+    hash_builder << txout_root->get_hash();
+  }
+  return hash_builder.FinalValue();
+}
 
 }  // namespace coin
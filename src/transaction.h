@@ -1,6 +1,8 @@
 #ifndef __TRANSACTION_H__
 #define __TRANSACTION_H__
 
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -27,7 +29,7 @@ class TransactionBase {
   /// Set timestamp.
   void set_time(time_t time) { time_ = time; }
 
-  /// Get hash value.
+  /// Get hash value, updated by CalcHash() of transactions caching it.
   const bn::HashNum &get_hash() const { return hash_; }
   bn::HashNum &get_hash() { return hash_; }
 
@@ -38,61 +40,90 @@ class TransactionBase {
   virtual int get_type() const = 0;
 
   /// Calculate hash value.
-  virtual const data::Buffer CalcHash() const = 0;
+  virtual const data::Buffer &CalcHash() const = 0;
+
+ protected:
+  /// Publish a hash value calculated by a const CalcHash().
+  void CacheHash(const data::Buffer &hash) const {
+    assert(hash.value.size() == sizeof(bn::HashNum));
+    hash_.Assign(hash.value.data());
+  }
 
  private:
   time_t time_ = 0;
-  bn::HashNum hash_;
+  mutable bn::HashNum hash_;
 };
 
 /// Transaction incoming tx.
 struct TxIn {
-  bn::HashNum tx_hash;    // From transaction hash value.
-  int out_index;           // txout index.
-  data::Buffer signature;  // Signature of hash(tx_hash + out_index).
+  bn::HashNum tx_hash;          // From transaction hash value.
+  int out_index;                // txout index.
+  data::ArenaBuffer signature;  // Signature of hash(tx_hash + out_index).
+
+  /// Keep the signature in an arena, or on the heap without one.
+  explicit TxIn(data::Arena *arena = nullptr)
+      : signature(data::ArenaBytes::allocator_type(arena)) {}
 
   data::Buffer CalcHash() const {
     Hash256Builder hash_builder;
-    hash_builder << data::MakeValue(tx_hash) << data::MakeValue(out_index) << signature;
+    Serialize(hash_builder);
     return hash_builder.FinalValue();
   }
 
   template <typename Stream>
   void Serialize(Stream &s) const {
     data::MakeValue(tx_hash).WriteToStream(s);
-    data::MakeValue(out_index).WriteToStream(s);
+    data::WriteInt(s, out_index);
     signature.WriteToStream(s);
   }
 
   template <typename Stream>
   void Unserialize(Stream &s) {
-    data::MakeValue(tx_hash).ReadFromStream(s);
-    out_index = data::ReadValue<uint32_t>(s);
+    data::Value<bn::HashNum> hash;
+    hash.ReadFromStream(s);
+    tx_hash = hash.get_num();
+    out_index = data::ReadInt<int>(s);
     signature.ReadFromStream(s);
   }
+
+  /// Number of bytes Serialize() writes.
+  size_t GetSerializedSize(data::Format format = data::Format::Legacy) const {
+    return sizeof(tx_hash) + data::GetIntSize(out_index, format) +
+           signature.GetSerializedSize(format);
+  }
 };
 
 /// Transaction outcoming tx.
 struct TxOut {
-  std::string address;  // To address.
-  uint64_t amount;      // Transfer amount.
+  data::ArenaString address;  // To address.
+  uint64_t amount;            // Transfer amount.
+
+  /// Keep the address in an arena, or on the heap without one.
+  explicit TxOut(data::Arena *arena = nullptr)
+      : address(data::ArenaString::allocator_type(arena)) {}
 
   data::Buffer CalcHash() const {
     Hash256Builder hash_builder;
-    hash_builder << data::MakeValue(address) << data::MakeValue(amount);
+    Serialize(hash_builder);
     return hash_builder.FinalValue();
   }
 
   template <typename Stream>
   void Serialize(Stream &s) const {
     data::MakeValue(address).WriteToStream(s);
-    data::MakeValue(amount).WriteToStream(s);
+    data::WriteInt(s, amount);
   }
 
   template <typename Stream>
   void Unserialize(Stream &s) {
-    address = data::ReadValue<std::string>(s);
-    amount = data::ReadValue<uint64_t>(s);
+    data::ReadBytes(s, address);
+    amount = data::ReadInt<uint64_t>(s);
+  }
+
+  /// Number of bytes Serialize() writes.
+  size_t GetSerializedSize(data::Format format = data::Format::Legacy) const {
+    return data::GetLengthSize(address.size(), format) + address.size() +
+           data::GetIntSize(amount, format);
   }
 };
 
@@ -110,6 +141,27 @@ namespace tx {
 data::Buffer MakeTxSignature(const ecdsa::Key &key, const data::Buffer &tx_hash,
                              int out_index);
 
+/**
+ * @brief Absorb tx_hash, the prefix shared by signatures of every out index.
+ *
+ * @param tx_hash Transaction hash value.
+ *
+ * @return Hash midstate for MakeTxSignature.
+ */
+Hash256 MakeTxSignatureMidstate(const data::Buffer &tx_hash);
+
+/**
+ * @brief Make a signature for tx from a midstate.
+ *
+ * @param key Private key to make signature.
+ * @param midstate Midstate from MakeTxSignatureMidstate.
+ * @param out_index Out index.
+ *
+ * @return Signature data.
+ */
+data::Buffer MakeTxSignature(const ecdsa::Key &key, const Hash256 &midstate,
+                             int out_index);
+
 }  // namespace tx
 
 /// Spend transaction.
@@ -118,6 +170,23 @@ class Transaction : public TransactionBase {
   enum { TypeValue = 0 };
 
  public:
+  /**
+   * Create an empty transaction.
+   *
+   * With an arena, Unserialize() reads the public key, the TxIn and TxOut
+   * lists and their signatures and addresses into it, the transaction must
+   * not be used after Arena::Reset() then. A copy lives on the heap.
+   *
+   * @param arena Arena to allocate from, or nullptr for the heap.
+   */
+  explicit Transaction(data::Arena *arena = nullptr);
+
+  /// Copies and moves keep a calculated hash value.
+  Transaction(const Transaction &another);
+  Transaction(Transaction &&another);
+  Transaction &operator=(const Transaction &another);
+  Transaction &operator=(Transaction &&another);
+
   /// The type of current transaction.
   virtual int get_type() const override { return Transaction::TypeValue; }
 
@@ -139,33 +208,18 @@ class Transaction : public TransactionBase {
     pub_key_.WriteToStream(s);                     // public key
 
     // Tx in/out merkle tree hash value.
-    auto txin_root = mt::MakeMerkleTree(vec_txin);    // TxIn
-    auto txout_root = mt::MakeMerkleTree(vec_txout);  // TxOut
-    Hash256Builder hash_builder;
-    if (txin_root) {
-      hash_builder << txin_root->get_hash();
-    }
-    if (txout_root) {
-      hash_builder << txout_root->get_hash();
-    }
-    hash_builder.FinalValue().WriteToStream(s);
-
-    // TxIn list.
-    data::MakeValue(static_cast<int>(vec_txin.size())).WriteToStream(s);
-    for (const TxIn &in : vec_txin) {
-      in.Serialize(s);
-    }
-
-    // TxOut list.
-    data::MakeValue(static_cast<int>(vec_txout.size())).WriteToStream(s);
-    for (const TxOut &out : vec_txout) {
-      out.Serialize(s);
-    }
+    CalcHash().WriteToStream(s);
+
+    // TxIn and TxOut lists.
+    data::WriteVector(s, vec_txin);
+    data::WriteVector(s, vec_txout);
   }
 
   /// Unserialize from stream.
   template <typename Stream>
   void Unserialize(Stream &s) {
+    hash_valid_.store(false, std::memory_order_relaxed);
+
     // Type.
     int type = data::ReadValue<int>(s);
     assert(type == Transaction::TypeValue);
@@ -176,44 +230,44 @@ class Transaction : public TransactionBase {
     // Public key.
     pub_key_.ReadFromStream(s);
 
-    // Merkle tree hash value.
-    auto merkle_hash = data::ReadValue<std::vector<uint8_t>>(s);
-
-    // TxIn list.
-    auto txin_n = data::ReadValue<int>(s);
-    for (int i = 0; i < txin_n; ++i) {
-      TxIn txin;
-      txin.Unserialize(s);
-      vec_txin.push_back(txin);
-    }
-
-    // TxOut list.
-    auto txout_n = data::ReadValue<int>(s);
-    for (int i = 0; i < txout_n; ++i) {
-      TxOut txout;
-      txout.Unserialize(s);
-      vec_txout.push_back(txout);
-    }
-  }
+    // Merkle tree hash value, recalculated by CalcHash().
+    data::ArenaBuffer merkle_hash(pub_key_.value.get_allocator());
+    merkle_hash.ReadFromStream(s);
 
-  virtual const data::Buffer CalcHash() const override {
-    auto txin_root = mt::MakeMerkleTree(vec_txin);    // TxIn
-    auto txout_root = mt::MakeMerkleTree(vec_txout);  // TxOut
-    Hash256Builder hash_builder;
-    if (txin_root) {
-      hash_builder << txin_root->get_hash();
-    }
-    if (txout_root) {
-      hash_builder << txout_root->get_hash();
-    }
-    data::Buffer hash_data = hash_builder.FinalValue();
-    return hash_data;
+    // TxIn list, at least hash value, out index and signature length.
+    data::ReadVector(s, vec_txin, sizeof(bn::HashNum) + 2);
+
+    // TxOut list, at least address length and amount.
+    data::ReadVector(s, vec_txout, 2);
   }
 
+  /**
+   * Number of bytes Serialize() writes, computed without serializing or
+   * allocating, e.g. to reserve a buffer or check a size limit.
+   */
+  size_t GetSerializedSize(data::Format format = data::Format::Legacy) const;
+
+  /**
+   * Hash value of TxIn and TxOut merkle roots.
+   *
+   * The value is cached until the transaction is changed by set_pub_key(),
+   * add_tx_in(), add_tx_out() or Unserialize(), and also stored as
+   * get_hash(). Like the other const methods it may be called from several
+   * threads at once, the first call calculates the value under a lock. The
+   * reference stays valid until the transaction is changed.
+   */
+  virtual const data::Buffer &CalcHash() const override;
+
+ private:
+  data::Buffer CalcMerkleHash() const;
+
  private:
-  data::Buffer pub_key_;
-  std::vector<TxIn> vec_txin;
-  std::vector<TxOut> vec_txout;
+  data::ArenaBuffer pub_key_;
+  std::vector<TxIn, data::ArenaAllocator<TxIn>> vec_txin;
+  std::vector<TxOut, data::ArenaAllocator<TxOut>> vec_txout;
+  mutable data::Buffer hash_cache_;
+  mutable std::atomic<bool> hash_valid_{false};
+  mutable std::mutex hash_mutex_;
 };
 
 }  // namespace coin
@@ -0,0 +1,149 @@
+#include "transaction_view.h"
+
+namespace coin {
+
+namespace {
+
+/// Reader over [p, end) of a record Parse() already checked.
+data::ByteReader MakeReader(const uint8_t *p, const uint8_t *end,
+                            data::Format format) {
+  data::ByteReader reader(p, end - p);
+  reader.set_format(format);
+  return reader;
+}
+
+/**
+ * Walk a serialized transaction.
+ *
+ * @param reader Reader positioned at the transaction.
+ * @param txin_offsets Receives the TxIn offsets from the start, or nullptr.
+ * @param txout_offsets Receives the TxOut offsets, or nullptr.
+ * @param merkle_hash_offset Receives the merkle hash offset, or nullptr.
+ *
+ * @return False if the record is truncated or not a Transaction.
+ */
+bool ScanTransaction(data::ByteReader &reader,
+                     TransactionView::OffsetTable *txin_offsets,
+                     TransactionView::OffsetTable *txout_offsets,
+                     size_t *merkle_hash_offset) {
+  size_t start = reader.get_position();
+  if (data::ReadValue<int>(reader) != Transaction::TypeValue) return false;
+  data::ReadValue<time_t>(reader);
+  data::ReadSpan(reader);  // public key
+  if (merkle_hash_offset) {
+    *merkle_hash_offset = reader.get_position() - start;
+  }
+  data::ReadSpan(reader);
+
+  uint32_t txin_n = data::ReadLength(reader);
+  for (uint32_t i = 0; i < txin_n && reader.good(); ++i) {
+    if (txin_offsets) txin_offsets->push_back(reader.get_position() - start);
+    reader.Skip(sizeof(bn::HashNum));
+    data::ReadInt<int>(reader);
+    data::ReadSpan(reader);  // signature
+  }
+
+  uint32_t txout_n = data::ReadLength(reader);
+  for (uint32_t i = 0; i < txout_n && reader.good(); ++i) {
+    if (txout_offsets) {
+      txout_offsets->push_back(reader.get_position() - start);
+    }
+    data::ReadSpan(reader);  // address
+    data::ReadInt<uint64_t>(reader);
+  }
+  return reader.good();
+}
+
+}  // namespace
+
+int TxInView::get_out_index() const {
+  data::ByteReader reader =
+      MakeReader(p_ + sizeof(bn::HashNum), end_, format_);
+  return data::ReadInt<int>(reader);
+}
+
+data::ByteSpan TxInView::get_signature() const {
+  data::ByteReader reader =
+      MakeReader(p_ + sizeof(bn::HashNum), end_, format_);
+  data::ReadInt<int>(reader);
+  return data::ReadSpan(reader);
+}
+
+void TxInView::ToTxIn(TxIn &in) const {
+  data::ByteReader reader = MakeReader(p_, end_, format_);
+  in.Unserialize(reader);
+}
+
+data::ByteSpan TxOutView::get_address() const {
+  data::ByteReader reader = MakeReader(p_, end_, format_);
+  return data::ReadSpan(reader);
+}
+
+uint64_t TxOutView::get_amount() const {
+  data::ByteReader reader = MakeReader(p_, end_, format_);
+  data::ReadSpan(reader);
+  return data::ReadInt<uint64_t>(reader);
+}
+
+void TxOutView::ToTxOut(TxOut &out) const {
+  data::ByteReader reader = MakeReader(p_, end_, format_);
+  out.Unserialize(reader);
+}
+
+bool TransactionView::Parse(const uint8_t *p, size_t size,
+                            data::Format format) {
+  txin_offsets_.clear();
+  txout_offsets_.clear();
+  data::ByteReader reader(p, size);
+  reader.set_format(format);
+  if (!ScanTransaction(reader, &txin_offsets_, &txout_offsets_,
+                       &merkle_hash_offset_)) {
+    p_ = nullptr;
+    size_ = 0;
+    txin_offsets_.clear();
+    txout_offsets_.clear();
+    return false;
+  }
+  p_ = p;
+  size_ = reader.get_position();
+  format_ = format;
+  return true;
+}
+
+size_t TransactionView::GetSerializedSize(const uint8_t *p, size_t size,
+                                          data::Format format) {
+  data::ByteReader reader(p, size);
+  reader.set_format(format);
+  if (!ScanTransaction(reader, nullptr, nullptr, nullptr)) return 0;
+  return reader.get_position();
+}
+
+int TransactionView::get_type() const {
+  data::ByteReader reader = MakeReader(p_, p_ + size_, format_);
+  return data::ReadValue<int>(reader);
+}
+
+time_t TransactionView::get_time() const {
+  data::ByteReader reader = MakeReader(p_ + sizeof(int), p_ + size_, format_);
+  return data::ReadValue<time_t>(reader);
+}
+
+data::ByteSpan TransactionView::get_pub_key() const {
+  data::ByteReader reader =
+      MakeReader(p_ + PUB_KEY_OFFSET, p_ + size_, format_);
+  return data::ReadSpan(reader);
+}
+
+data::ByteSpan TransactionView::get_merkle_hash() const {
+  data::ByteReader reader =
+      MakeReader(p_ + merkle_hash_offset_, p_ + size_, format_);
+  return data::ReadSpan(reader);
+}
+
+void TransactionView::ToTransaction(Transaction &tx) const {
+  data::ByteReader reader(p_, size_);
+  reader.set_format(format_);
+  tx.Unserialize(reader);
+}
+
+}  // namespace coin
@@ -0,0 +1,130 @@
+#ifndef __TRANSACTION_VIEW_H__
+#define __TRANSACTION_VIEW_H__
+
+#include <cstdint>
+#include <ctime>
+
+#include <vector>
+
+#include "arena.h"
+#include "big_num.h"
+#include "byte_stream.h"
+#include "data_value.h"
+#include "transaction.h"
+
+namespace coin {
+
+/// TxIn decoded on demand from its serialized bytes.
+class TxInView {
+ public:
+  TxInView(const uint8_t *p, const uint8_t *end, data::Format format)
+      : p_(p), end_(end), format_(format) {}
+
+  bn::HashNum get_tx_hash() const { return bn::HashNum(p_); }
+  int get_out_index() const;
+  data::ByteSpan get_signature() const;
+
+  /// Decode into a TxIn.
+  void ToTxIn(TxIn &in) const;
+
+ private:
+  const uint8_t *p_;
+  const uint8_t *end_;  // End of the transaction.
+  data::Format format_;
+};
+
+/// TxOut decoded on demand from its serialized bytes.
+class TxOutView {
+ public:
+  TxOutView(const uint8_t *p, const uint8_t *end, data::Format format)
+      : p_(p), end_(end), format_(format) {}
+
+  data::ByteSpan get_address() const;
+  uint64_t get_amount() const;
+
+  /// Decode into a TxOut.
+  void ToTxOut(TxOut &out) const;
+
+ private:
+  const uint8_t *p_;
+  const uint8_t *end_;  // End of the transaction.
+  data::Format format_;
+};
+
+/**
+ * Read-only view of a serialized Transaction.
+ *
+ * Parse() checks the record and builds a table of TxIn and TxOut offsets in
+ * one pass, fields are decoded only when asked for. Nothing is copied, the
+ * bytes, e.g. a ByteWriter buffer or a MappedFile, must outlive the view
+ * and the TxIn and TxOut views it returns. The offset tables are allocated
+ * from an Arena if one is given.
+ */
+class TransactionView {
+ public:
+  typedef std::vector<size_t, data::ArenaAllocator<size_t>> OffsetTable;
+
+  explicit TransactionView(data::Arena *arena = nullptr)
+      : txin_offsets_(arena), txout_offsets_(arena) {}
+
+  /**
+   * Index the transaction at the start of a byte range.
+   *
+   * @param p Serialized transaction, may be followed by other records.
+   * @param size Number of bytes available at p.
+   * @param format Format the transaction was serialized in.
+   *
+   * @return False if the record is truncated or not a Transaction.
+   */
+  bool Parse(const uint8_t *p, size_t size,
+             data::Format format = data::Format::Legacy);
+
+  /**
+   * Size of the transaction at the start of a byte range, without building
+   * the offset table.
+   *
+   * @return Size in bytes, or 0 if the record is truncated or not a
+   * Transaction.
+   */
+  static size_t GetSerializedSize(const uint8_t *p, size_t size,
+                                  data::Format format = data::Format::Legacy);
+
+  /// Serialized bytes of the transaction.
+  data::ByteSpan get_bytes() const { return data::ByteSpan(p_, size_); }
+
+  int get_type() const;
+  time_t get_time() const;
+  data::ByteSpan get_pub_key() const;
+
+  /// Hash value of the TxIn and TxOut merkle roots, as stored.
+  data::ByteSpan get_merkle_hash() const;
+
+  size_t txin_count() const { return txin_offsets_.size(); }
+  size_t txout_count() const { return txout_offsets_.size(); }
+
+  TxInView GetTxIn(size_t index) const {
+    return TxInView(p_ + txin_offsets_[index], p_ + size_, format_);
+  }
+
+  TxOutView GetTxOut(size_t index) const {
+    return TxOutView(p_ + txout_offsets_[index], p_ + size_, format_);
+  }
+
+  /// Decode into a Transaction.
+  void ToTransaction(Transaction &tx) const;
+
+ private:
+  /// Offset of the public key, right after the type and timestamp.
+  static const size_t PUB_KEY_OFFSET = sizeof(int) + sizeof(time_t);
+
+  const uint8_t *p_ = nullptr;
+  size_t size_ = 0;
+  data::Format format_ = data::Format::Legacy;
+  size_t merkle_hash_offset_ = 0;
+  OffsetTable txin_offsets_;
+  OffsetTable txout_offsets_;
+};
+
+}  // namespace coin
+
+#endif
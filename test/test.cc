@@ -1,14 +1,38 @@
+#include <algorithm>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openssl/sha.h>
+
 #include "gtest/gtest.h"
 
+#include "address.h"
+#include "arena.h"
+#include "base58.h"
 #include "big_num.h"
 #include "data_value.h"
+#include "disk_tree.h"
+#include "file_merkle.h"
+#include "flat_tree.h"
+#include "incremental_tree.h"
+#include "merkle_accumulator.h"
+#include "merkle_diff.h"
+#include "merkle_proof.h"
+#include "hex.h"
 #include "transaction.h"
 #include "block.h"
 #include "block_builder.h"
+#include "block_view.h"
+#include "byte_stream.h"
+#include "sha256.h"
+#include "sparse_tree.h"
+#include "thread_pool.h"
 
 template <typename T>
 std::tuple<T, bool> StreamReadWriteValCompare() {
@@ -85,6 +109,275 @@ TEST(DataValue, String) {
   EXPECT_EQ(value_obj.value, TEST_STRING) << "String value: " << TEST_STRING;
 }
 
+TEST(ThreadPool, ParallelForCoversRange) {
+  coin::ThreadPool pool(4);
+  EXPECT_EQ(pool.get_num_threads(), 4);
+  std::vector<int> counts(1000);
+  for (int round = 0; round < 10; ++round) {
+    pool.ParallelFor(counts.size(), 7, [&counts](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) ++counts[i];
+    });
+  }
+  for (int count : counts) EXPECT_EQ(count, 10);
+  pool.ParallelFor(0, 1, [](size_t, size_t) { FAIL(); });
+}
+
+TEST(HashBuilder, StreamMatchesSerializedData) {
+  coin::TxOut tx_out;
+  tx_out.address = "12iPmmNQQ9oqnjT5Nj7eg7bPmQtLXUQUmq";
+  tx_out.amount = 1000;
+  std::stringstream ss;
+  tx_out.Serialize(ss);
+  std::string data = ss.str();
+  auto hash = coin::Hash256Builder::CalculateHash(
+      reinterpret_cast<const uint8_t *>(data.data()), data.size());
+  EXPECT_EQ(tx_out.CalcHash().value, hash);
+}
+
+TEST(HashBuilder, EmptyBuffer) {
+  coin::Hash256Builder hash_builder;
+  hash_builder << coin::data::Buffer();
+  const uint8_t zero_size[4] = {0, 0, 0, 0};
+  EXPECT_EQ(hash_builder.FinalValue().value,
+            coin::Hash256Builder::CalculateHash(zero_size, sizeof(zero_size)));
+}
+
+TEST(Sha256, KnownAnswer) {
+  const std::string MSG = "abc";
+  auto md = coin::Hash256Builder::CalculateHash(
+      reinterpret_cast<const uint8_t *>(MSG.data()), MSG.size());
+  EXPECT_EQ(coin::HashToStr(md, 32),
+            "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad")
+      << "Kernel: " << coin::sha256::GetImplementation();
+}
+
+TEST(Sha256, MatchesOpenSSL) {
+  std::vector<uint8_t> data(300);
+  for (size_t i = 0; i < data.size(); ++i) data[i] = rand() % 256;
+  for (size_t size = 0; size <= data.size(); ++size) {
+    uint8_t expected[SHA256_DIGEST_LENGTH];
+    SHA256(data.data(), size, expected);
+    // Feed in two parts to exercise the partial block buffer.
+    coin::Hash256 algo;
+    algo.Calculate(data.data(), size / 3);
+    algo.Calculate(data.data() + size / 3, size - size / 3);
+    algo.Final();
+    EXPECT_EQ(memcmp(algo.get_md(), expected, sizeof(expected)), 0)
+        << "Size: " << size;
+  }
+}
+
+TEST(Sha256, LaneKernels) {
+#ifdef SYSUTILS_X86_KERNELS
+  const sysutils::CpuFeatures &features = sysutils::GetCpuFeatures();
+  uint8_t blocks[8][coin::sha256::BLOCK_SIZE];
+  uint32_t s[8][8], expected[8][8];
+  uint32_t *states[8];
+  const uint8_t *pblocks[8];
+  for (int k = 0; k < 8; ++k) {
+    for (int i = 0; i < 64; ++i) blocks[k][i] = rand() % 256;
+    for (int i = 0; i < 8; ++i) s[k][i] = expected[k][i] = rand();
+    coin::sha256::TransformPortable(expected[k], blocks[k], 1);
+    states[k] = s[k];
+    pblocks[k] = blocks[k];
+  }
+  if (features.avx2) {
+    coin::sha256::TransformAVX2x8(states, pblocks);
+    EXPECT_EQ(memcmp(s, expected, sizeof(s)), 0);
+  }
+  if (features.sse41 && features.ssse3) {
+    for (int k = 0; k < 4; ++k) {
+      memcpy(s[k], expected[k], sizeof(s[k]));
+      coin::sha256::TransformPortable(expected[k], blocks[k], 1);
+    }
+    coin::sha256::TransformSSE41x4(states, pblocks);
+    EXPECT_EQ(memcmp(s, expected, sizeof(uint32_t) * 8 * 4), 0);
+  }
+#endif
+}
+
+#ifdef SYSUTILS_X86_KERNELS
+/// Run messages of different block counts through a lane kernel, lanes that
+/// are done compress a scratch block into a scratch state, and compare each
+/// lane with the portable kernel.
+static void CheckLaneKernel(coin::sha256::TransformLanesFunc transform_n,
+                            size_t width) {
+  const size_t BLOCK_SIZE = coin::sha256::BLOCK_SIZE;
+  const size_t counts[8] = {3, 1, 5, 2, 8, 1, 4, 6};
+  std::vector<uint8_t> messages[8];
+  uint32_t s[8][8], expected[8][8], scratch[8][8];
+  uint8_t scratch_block[BLOCK_SIZE] = {0};
+  uint32_t *states[8];
+  const uint8_t *blocks[8];
+  size_t rounds = 0;
+  for (size_t k = 0; k < width; ++k) {
+    messages[k].resize(counts[k] * BLOCK_SIZE);
+    for (uint8_t &b : messages[k]) b = rand() % 256;
+    for (int i = 0; i < 8; ++i) s[k][i] = expected[k][i] = rand();
+    coin::sha256::TransformPortable(expected[k], messages[k].data(),
+                                    counts[k]);
+    rounds = std::max(rounds, counts[k]);
+  }
+  for (size_t r = 0; r < rounds; ++r) {
+    for (size_t k = 0; k < width; ++k) {
+      bool done = r >= counts[k];
+      states[k] = done ? scratch[k] : s[k];
+      blocks[k] = done ? scratch_block : messages[k].data() + r * BLOCK_SIZE;
+    }
+    transform_n(states, blocks);
+  }
+  for (size_t k = 0; k < width; ++k) {
+    EXPECT_EQ(memcmp(s[k], expected[k], sizeof(s[k])), 0) << "Lane: " << k;
+  }
+}
+#endif
+
+TEST(Sha256, LaneKernelsUnequalLengths) {
+#ifdef SYSUTILS_X86_KERNELS
+  const sysutils::CpuFeatures &features = sysutils::GetCpuFeatures();
+  if (features.avx2) {
+    CheckLaneKernel(coin::sha256::TransformAVX2x8, 8);
+  }
+  if (features.sse41 && features.ssse3) {
+    CheckLaneKernel(coin::sha256::TransformSSE41x4, 4);
+  }
+#endif
+}
+
+TEST(Hash256Batch, MatchesSingleHash) {
+  std::vector<std::vector<uint8_t>> messages;
+  for (int i = 0; i < 45; ++i) {
+    std::vector<uint8_t> message(rand() % 200);
+    for (uint8_t &b : message) b = rand() % 256;
+    messages.push_back(message);
+  }
+  coin::Hash256Batch batch;
+  for (const auto &message : messages) batch.Add(message);
+  batch.Calculate();
+  ASSERT_EQ(batch.size(), messages.size());
+  for (size_t i = 0; i < messages.size(); ++i) {
+    EXPECT_EQ(batch.GetValue(i).value,
+              coin::Hash256Builder::CalculateHash(messages[i]))
+        << "Message: " << i;
+  }
+}
+
+TEST(Hash64To32, MatchesHash256) {
+  const size_t N = 13;
+  std::vector<uint8_t> in(64 * N), out(32 * N);
+  for (uint8_t &b : in) b = rand() % 256;
+  coin::Hash64To32(in.data(), out.data(), N);
+  for (size_t i = 0; i < N; ++i) {
+    auto expected = coin::Hash256Builder::CalculateHash(in.data() + i * 64, 64);
+    EXPECT_EQ(memcmp(out.data() + i * 32, expected.data(), 32), 0);
+  }
+  uint8_t single[32];
+  coin::Hash64To32(in.data(), single);
+  EXPECT_EQ(memcmp(single, out.data(), 32), 0);
+}
+
+TEST(Hash256, SnapshotRestore) {
+  const std::string PREFIX(100, 'p');
+  coin::Hash256 algo;
+  algo.Calculate(reinterpret_cast<const uint8_t *>(PREFIX.data()),
+                 PREFIX.size());
+  coin::sha256::Context midstate = algo.Snapshot();
+  for (const std::string suffix : {"a", "bb", "ccc"}) {
+    algo.Restore(midstate);
+    algo.Calculate(reinterpret_cast<const uint8_t *>(suffix.data()),
+                   suffix.size());
+    algo.Final();
+    std::string message = PREFIX + suffix;
+    auto expected = coin::Hash256Builder::CalculateHash(
+        reinterpret_cast<const uint8_t *>(message.data()), message.size());
+    EXPECT_EQ(memcmp(algo.get_md(), expected.data(), expected.size()), 0);
+  }
+}
+
+TEST(Hash160, KnownAnswer) {
+  const std::string MSG = "abc";
+  auto md = coin::Hash160Builder::CalculateHash(
+      reinterpret_cast<const uint8_t *>(MSG.data()), MSG.size());
+  EXPECT_EQ(coin::HashToStr(md, 20),
+            "8eb208f7e05d987a9b044a8e98c6b087f15a0bfc");
+}
+
+/// Public key and address from the Bitcoin wiki, "Technical background of
+/// version 1 Bitcoin addresses".
+const char *TEST_PUB_KEY =
+    "0250863ad64a87ae8a2fe83c1af1a8403cb53f53e486d8511dad8a04887e5b2352";
+const char *TEST_ADDRESS = "1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs";
+
+TEST(Address, FromPublicKey) {
+  auto pub_key = coin::bn::BigNum<33>::FromString(TEST_PUB_KEY);
+  std::vector<uint8_t> data(pub_key.get_data(), pub_key.get_data() + 33);
+  EXPECT_EQ(coin::Address::FromPublicKey(data).ToString(), TEST_ADDRESS);
+}
+
+TEST(Address, Batch) {
+  auto pub_key = coin::bn::BigNum<33>::FromString(TEST_PUB_KEY);
+  std::vector<std::vector<uint8_t>> pub_keys;
+  for (int i = 0; i < 21; ++i) {
+    std::vector<uint8_t> data(pub_key.get_data(), pub_key.get_data() + 33);
+    data[32] += i;
+    pub_keys.push_back(data);
+  }
+  coin::AddressBatch batch;
+  batch.FromPublicKeys(pub_keys);
+  ASSERT_EQ(batch.size(), pub_keys.size());
+  EXPECT_EQ(batch.ToString(0), TEST_ADDRESS);
+  for (size_t i = 0; i < pub_keys.size(); ++i) {
+    EXPECT_EQ(batch.ToString(i),
+              coin::Address::FromPublicKey(pub_keys[i]).ToString());
+  }
+}
+
+TEST(Base58, RoundTrip) {
+  std::vector<uint8_t> data = {0, 0, 1, 2, 3, 250, 251, 252};
+  std::string str = base58::EncodeBase58(data);
+  EXPECT_EQ(str.substr(0, 2), "11");
+  std::vector<uint8_t> decoded;
+  EXPECT_TRUE(base58::DecodeBase58(str, decoded));
+  EXPECT_EQ(decoded, data);
+  char small[4];
+  EXPECT_EQ(base58::EncodeBase58(data.data(), data.data() + data.size(), small,
+                                 sizeof(small)),
+            0);
+}
+
+TEST(Hex, EncodeDecode) {
+  // Long enough to cover the vector loops and the scalar tails.
+  std::vector<uint8_t> data(1000);
+  for (size_t i = 0; i < data.size(); ++i) data[i] = i * 7 + (i >> 8);
+  std::string str = coin::hex::Encode(data);
+  ASSERT_EQ(str.size(), data.size() * 2);
+  for (size_t i = 0; i < data.size(); ++i) {
+    char digits[3];
+    sprintf(digits, "%02x", data[i]);
+    ASSERT_EQ(str.substr(i * 2, 2), digits);
+  }
+  std::vector<uint8_t> decoded;
+  EXPECT_TRUE(coin::hex::Decode(str, decoded));
+  EXPECT_EQ(decoded, data);
+
+  std::string upper = "00FFaB10Cd";
+  EXPECT_TRUE(coin::hex::Decode(upper, decoded));
+  EXPECT_EQ(coin::hex::Encode(decoded), "00ffab10cd");
+}
+
+TEST(Hex, RejectsInvalidDigits) {
+  std::string str = coin::hex::Encode(std::vector<uint8_t>(100, 0x5a));
+  std::vector<uint8_t> decoded;
+  EXPECT_FALSE(coin::hex::Decode(str.substr(1), decoded));
+  for (char c : {'g', 'G', '/', ':', '@', '`', ' ', '\x80', '\xff'}) {
+    for (size_t pos : {0, 17, 63, 64, 199}) {
+      std::string bad = str;
+      bad[pos] = c;
+      EXPECT_FALSE(coin::hex::Decode(bad, decoded)) << pos << " " << c;
+    }
+  }
+}
+
 /// Randomized data.
 std::vector<uint8_t> g_random_data;
 const uint32_t g_random_data_size = 1024 * 1024 * 2;
@@ -143,6 +436,27 @@ TEST(MerkleTree, BuildTree) {
   EXPECT_TRUE(g_proot != nullptr);
 }
 
+TEST(MerkleTree, HashChunksMatchesTree) {
+  coin::ThreadPool pool(4);
+  auto root = coin::mt::HashChunks(g_random_data.data(), g_random_data.size(),
+                                   g_bytes_each_trunk, pool);
+  EXPECT_EQ(root.value, g_proot->get_hash().value);
+
+  char path[] = "/tmp/cryptocoin_test_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(write(fd, g_random_data.data(), g_random_data.size()),
+            static_cast<ssize_t>(g_random_data.size()));
+  close(fd);
+  coin::mt::FileHashResult result;
+  EXPECT_TRUE(coin::mt::HashFile(path, g_bytes_each_trunk, pool, result));
+  unlink(path);
+  EXPECT_EQ(result.root.value, g_proot->get_hash().value);
+  EXPECT_EQ(result.file_size, g_random_data.size());
+  EXPECT_EQ(result.num_chunks, g_vec_trunk.size());
+  EXPECT_FALSE(coin::mt::HashFile(path, g_bytes_each_trunk, pool, result));
+}
+
 TEST(MerkleTree, VerifyData_Diff) {
   auto vec_trunk_dup = g_vec_trunk;
   EXPECT_TRUE(!vec_trunk_dup.empty());
@@ -154,6 +468,537 @@ TEST(MerkleTree, VerifyData_Diff) {
   EXPECT_TRUE(g_proot_dup->get_hash().value != g_proot->get_hash().value);
 }
 
+TEST(MerkleTree, BatchMatchesPairHash) {
+  std::vector<Trunk> trunks(5);
+  for (size_t i = 0; i < trunks.size(); ++i) trunks[i].data.assign(10, i);
+  typedef coin::mt::Node<Trunk> TrunkNode;
+  std::vector<TrunkNode::NodePtr> leaves;
+  for (const Trunk &trunk : trunks) {
+    leaves.push_back(std::make_shared<TrunkNode>(trunk));
+  }
+  auto n01 = std::make_shared<TrunkNode>(leaves[0], leaves[1]);
+  auto n23 = std::make_shared<TrunkNode>(leaves[2], leaves[3]);
+  auto n0123 = std::make_shared<TrunkNode>(n01, n23);
+  TrunkNode root(n0123, leaves[4]);
+  EXPECT_EQ(coin::mt::MakeMerkleTree(trunks)->get_hash().value,
+            root.get_hash().value);
+}
+
+TEST(MerkleTree, NodeHashModes) {
+  coin::data::Buffer left, right;
+  left.value.assign(32, 0x11);
+  right.value.assign(32, 0x22);
+  uint8_t out[32];
+
+  coin::Hash256Builder hash_builder;
+  hash_builder << left << right;
+  coin::mt::HashNode(left.value.data(), right.value.data(), out);
+  EXPECT_EQ(memcmp(out, hash_builder.FinalValue().value.data(), 32), 0);
+
+  std::vector<uint8_t> pair(left.value);
+  pair.insert(pair.end(), right.value.begin(), right.value.end());
+  coin::mt::HashNode(left.value.data(), right.value.data(), out,
+                     coin::mt::NodeHashMode::Hash64);
+  EXPECT_EQ(memcmp(out, coin::Hash256Builder::CalculateHash(pair).data(), 32),
+            0);
+  auto root =
+      coin::mt::MakeMerkleTree(g_vec_trunk, coin::mt::NodeHashMode::Hash64);
+  EXPECT_NE(root->get_hash().value, g_proot->get_hash().value);
+
+  // Trees with different modes coexist.
+  coin::bn::HashNum key(left.value.data());
+  coin::mt::SparseTree builder_tree;
+  coin::mt::SparseTree hash64_tree(coin::mt::NodeHashMode::Hash64);
+  builder_tree.Set(key, right.value.data());
+  hash64_tree.Set(key, right.value.data());
+  EXPECT_NE(builder_tree.Root().value, hash64_tree.Root().value);
+  coin::mt::SparseProof proof;
+  hash64_tree.MakeProof(key, proof);
+  EXPECT_TRUE(coin::mt::VerifySparseProof(key, right.value.data(), proof,
+                                          hash64_tree.GetRoot(),
+                                          coin::mt::NodeHashMode::Hash64));
+  EXPECT_FALSE(coin::mt::VerifySparseProof(key, right.value.data(), proof,
+                                           hash64_tree.GetRoot()));
+}
+
+TEST(FlatTree, MatchesMakeMerkleTree) {
+  for (auto mode :
+       {coin::mt::NodeHashMode::Builder, coin::mt::NodeHashMode::Hash64}) {
+    for (size_t n = 1; n <= g_vec_trunk.size(); ++n) {
+      std::vector<Trunk> trunks(g_vec_trunk.begin(), g_vec_trunk.begin() + n);
+      coin::mt::FlatTree tree(mode);
+      tree.BuildFrom(trunks);
+      EXPECT_EQ(tree.leaf_count(), n);
+      EXPECT_EQ(tree.level_size(tree.level_count() - 1), 1);
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(tree.GetRoot()) % 32, 0);
+      EXPECT_EQ(tree.Root().value,
+                coin::mt::MakeMerkleTree(trunks, mode)->get_hash().value);
+      EXPECT_EQ(tree.GetLeafHash(n - 1),
+                tree.GetHash(0, 0) + (n - 1) * coin::mt::HASH_SIZE);
+    }
+  }
+
+  coin::mt::FlatTree empty;
+  empty.BuildFrom(std::vector<Trunk>());
+  EXPECT_TRUE(empty.empty());
+  EXPECT_TRUE(empty.Root().value.empty());
+}
+
+TEST(FlatTree, ParallelBuildMatchesSerial) {
+  coin::ThreadPool pool(4);
+  std::vector<uint8_t> leaves = MakeRandomData(3000 * coin::mt::HASH_SIZE);
+  for (size_t n : {1, 2, 3, 7, 64, 1000, 1025, 3000}) {
+    coin::mt::FlatTree serial;
+    serial.Build(leaves.data(), n);
+    for (size_t cutoff : {size_t(1), size_t(2), size_t(100),
+                          coin::mt::DEFAULT_PARALLEL_CUTOFF}) {
+      coin::mt::FlatTree parallel;
+      parallel.BuildParallel(n,
+                             [&leaves](size_t index, uint8_t *out) {
+                               memcpy(out,
+                                      leaves.data() +
+                                          index * coin::mt::HASH_SIZE,
+                                      coin::mt::HASH_SIZE);
+                             },
+                             pool, cutoff);
+      ASSERT_EQ(parallel.Root().value, serial.Root().value) << n;
+    }
+  }
+  EXPECT_EQ(coin::mt::MakeMerkleRoot(g_vec_trunk, pool, 2).value,
+            g_proot->get_hash().value);
+}
+
+TEST(FlatTree, CopyAndMove) {
+  coin::mt::FlatTree tree;
+  tree.BuildFrom(g_vec_trunk);
+  coin::mt::FlatTree copy = tree;
+  EXPECT_EQ(copy.Root().value, tree.Root().value);
+  EXPECT_EQ(copy.get_memory_size(), tree.get_memory_size());
+  coin::mt::FlatTree moved = std::move(tree);
+  EXPECT_TRUE(tree.empty());
+  EXPECT_EQ(moved.Root().value, copy.Root().value);
+  EXPECT_EQ(moved.level_count(), 6);
+}
+
+TEST(IncrementalTree, MatchesFullBuild) {
+  const size_t HASH_SIZE = coin::mt::HASH_SIZE;
+  std::vector<uint8_t> pool = MakeRandomData(200 * HASH_SIZE);
+  std::vector<uint8_t> leaves;
+  coin::mt::IncrementalTree tree;
+  auto expect_root = [&leaves, &tree]() {
+    coin::mt::FlatTree full;
+    full.Build(leaves.data(), leaves.size() / HASH_SIZE);
+    EXPECT_EQ(tree.Root().value, full.Root().value);
+    EXPECT_EQ(tree.level_count(), full.level_count());
+  };
+
+  for (size_t i = 0; i < 70; ++i) {
+    const uint8_t *leaf = pool.data() + i * HASH_SIZE;
+    tree.Append(leaf);
+    leaves.insert(leaves.end(), leaf, leaf + HASH_SIZE);
+    expect_root();
+  }
+  for (size_t i = 0; i < 70; i += 3) {
+    const uint8_t *leaf = pool.data() + (100 + i) * HASH_SIZE;
+    tree.Replace(i, leaf);
+    memcpy(leaves.data() + i * HASH_SIZE, leaf, HASH_SIZE);
+    expect_root();
+  }
+  while (!tree.empty()) {
+    tree.RemoveLast();
+    leaves.resize(leaves.size() - HASH_SIZE);
+    expect_root();
+  }
+  EXPECT_TRUE(tree.Root().value.empty());
+
+  tree.Assign(pool.data(), 33);
+  leaves.assign(pool.begin(), pool.begin() + 33 * HASH_SIZE);
+  expect_root();
+}
+
+TEST(MerkleProof, AllLeavesVerify) {
+  const size_t HASH_SIZE = coin::mt::HASH_SIZE;
+  std::vector<uint8_t> leaves = MakeRandomData(40 * HASH_SIZE);
+  coin::mt::Proof proof;
+  for (size_t n = 1; n <= 40; ++n) {
+    coin::mt::FlatTree tree;
+    tree.Build(leaves.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+      ASSERT_TRUE(coin::mt::MakeProof(tree, i, proof));
+      EXPECT_TRUE(coin::mt::VerifyProof(tree.GetLeafHash(i), proof,
+                                        tree.GetRoot()))
+          << n << " " << i;
+      EXPECT_TRUE(coin::mt::VerifyProof(tree.GetLeafHash(i), proof,
+                                        tree.GetRoot(), n))
+          << n << " " << i;
+      if (n > 1) {
+        EXPECT_FALSE(coin::mt::VerifyProof(tree.GetLeafHash((i + 1) % n),
+                                           proof, tree.GetRoot()));
+      }
+    }
+    EXPECT_FALSE(coin::mt::MakeProof(tree, n, proof));
+  }
+
+  // 21 leaves, levels of 21, 11, 6, 3, 2 and 1 nodes: leaf 20 has a
+  // sibling on levels 2 and 4 only.
+  coin::mt::IncrementalTree tree;
+  tree.Assign(leaves.data(), 21);
+  ASSERT_TRUE(coin::mt::MakeProof(tree, 20, proof));
+  EXPECT_EQ(proof.num_siblings, 2);
+  EXPECT_EQ(proof.position_bits, 3);
+  EXPECT_TRUE(
+      coin::mt::VerifyProof(tree.GetLeafHash(20), proof, tree.GetRoot()));
+
+  // A proof does not verify under another leaf index.
+  ASSERT_TRUE(coin::mt::MakeProof(tree, 3, proof));
+  EXPECT_TRUE(
+      coin::mt::VerifyProof(tree.GetLeafHash(3), proof, tree.GetRoot()));
+  proof.leaf_index = 7;
+  EXPECT_FALSE(
+      coin::mt::VerifyProof(tree.GetLeafHash(3), proof, tree.GetRoot()));
+  EXPECT_FALSE(
+      coin::mt::VerifyProof(tree.GetLeafHash(3), proof, tree.GetRoot(), 21));
+  proof.leaf_index = 3;
+  proof.position_bits |= uint64_t(1) << proof.num_siblings;
+  EXPECT_FALSE(
+      coin::mt::VerifyProof(tree.GetLeafHash(3), proof, tree.GetRoot()));
+
+  // The bits 11 of leaf 20 also fit index 5 (101) with level 1 promoted,
+  // only the leaf count rules that out.
+  ASSERT_TRUE(coin::mt::MakeProof(tree, 20, proof));
+  proof.siblings[1][0] ^= 1;
+  EXPECT_FALSE(
+      coin::mt::VerifyProof(tree.GetLeafHash(20), proof, tree.GetRoot()));
+  proof.siblings[1][0] ^= 1;
+  proof.leaf_index = 5;
+  EXPECT_TRUE(
+      coin::mt::VerifyProof(tree.GetLeafHash(20), proof, tree.GetRoot()));
+  EXPECT_FALSE(
+      coin::mt::VerifyProof(tree.GetLeafHash(20), proof, tree.GetRoot(), 21));
+}
+
+TEST(MerkleProof, Serialize) {
+  coin::mt::FlatTree tree;
+  tree.BuildFrom(g_vec_trunk);
+  coin::mt::Proof proof;
+  ASSERT_TRUE(coin::mt::MakeProof(tree, 5, proof));
+  std::stringstream ss;
+  proof.Serialize(ss);
+  EXPECT_EQ(ss.str().size(), proof.GetSerializedSize());
+  coin::mt::Proof read_proof;
+  read_proof.Unserialize(ss);
+  EXPECT_EQ(read_proof.leaf_index, 5);
+  EXPECT_TRUE(coin::mt::VerifyProof(g_vec_trunk[5].CalcHash().value.data(),
+                                    read_proof,
+                                    g_proot->get_hash().value.data()));
+
+  // A path longer than any tree has fails the stream.
+  coin::data::ByteWriter writer;
+  coin::data::MakeValue(uint64_t(5)).WriteToStream(writer);
+  coin::data::MakeValue(uint64_t(1)).WriteToStream(writer);
+  coin::data::MakeValue(uint8_t(coin::mt::MAX_PROOF_DEPTH + 1))
+      .WriteToStream(writer);
+  coin::data::ByteReader reader(writer.get_data(), writer.get_size());
+  read_proof.Unserialize(reader);
+  EXPECT_EQ(read_proof.num_siblings, 0);
+  EXPECT_FALSE(reader.good());
+}
+
+TEST(MerkleProof, MultiProofRejectsHugeCounts) {
+  coin::data::ByteWriter writer;
+  coin::data::MakeValue(uint64_t(1) << 40).WriteToStream(writer);
+  coin::data::MakeValue(UINT32_MAX).WriteToStream(writer);
+  coin::data::ByteReader reader(writer.get_data(), writer.get_size());
+  coin::mt::MultiProof proof;
+  proof.Unserialize(reader);
+  EXPECT_TRUE(proof.leaf_indices.empty());
+  EXPECT_TRUE(proof.hashes.empty());
+  EXPECT_FALSE(reader.good());
+
+  // More hash values than the leaves can need.
+  writer.Clear();
+  coin::data::MakeValue(uint64_t(8)).WriteToStream(writer);
+  coin::data::MakeValue(uint32_t(1)).WriteToStream(writer);
+  coin::data::MakeValue(uint64_t(3)).WriteToStream(writer);
+  coin::data::MakeValue(uint32_t(coin::mt::MAX_PROOF_DEPTH + 1))
+      .WriteToStream(writer);
+  coin::data::ByteReader hash_reader(writer.get_data(), writer.get_size());
+  proof.Unserialize(hash_reader);
+  EXPECT_TRUE(proof.leaf_indices.empty());
+  EXPECT_TRUE(proof.hashes.empty());
+  EXPECT_FALSE(hash_reader.good());
+}
+
+TEST(MerkleProof, MultiProof) {
+  const size_t HASH_SIZE = coin::mt::HASH_SIZE;
+  std::vector<uint8_t> leaves = MakeRandomData(300 * HASH_SIZE);
+  for (size_t n : {1, 2, 5, 21, 64, 300}) {
+    coin::mt::FlatTree tree;
+    tree.Build(leaves.data(), n);
+    for (size_t step : {1, 2, 3, 7}) {
+      std::vector<uint64_t> indices;
+      for (size_t i = n - 1; i < n; i -= step) indices.push_back(i);
+      indices.push_back(n - 1);  // Duplicate.
+      coin::mt::MultiProof proof;
+      ASSERT_TRUE(coin::mt::MakeMultiProof(tree, indices, proof));
+      ASSERT_TRUE(std::is_sorted(proof.leaf_indices.begin(),
+                                 proof.leaf_indices.end()));
+      std::vector<uint8_t> proven;
+      size_t single_hashes = 0;
+      for (uint64_t i : proof.leaf_indices) {
+        proven.insert(proven.end(), tree.GetLeafHash(i),
+                      tree.GetLeafHash(i) + HASH_SIZE);
+        coin::mt::Proof single;
+        coin::mt::MakeProof(tree, i, single);
+        single_hashes += single.num_siblings;
+      }
+      EXPECT_LE(proof.num_hashes(), single_hashes);
+      EXPECT_TRUE(
+          coin::mt::VerifyMultiProof(proven.data(), proof, tree.GetRoot()))
+          << n << " " << step;
+
+      std::stringstream ss;
+      proof.Serialize(ss);
+      EXPECT_EQ(ss.str().size(), proof.GetSerializedSize());
+      coin::mt::MultiProof read_proof;
+      read_proof.Unserialize(ss);
+      EXPECT_TRUE(coin::mt::VerifyMultiProof(proven.data(), read_proof,
+                                             tree.GetRoot()));
+
+      proven[0] ^= 1;
+      EXPECT_FALSE(
+          coin::mt::VerifyMultiProof(proven.data(), proof, tree.GetRoot()));
+      if (proof.num_hashes() > 0) {
+        proof.hashes.pop_back();
+        EXPECT_FALSE(
+            coin::mt::VerifyMultiProof(proven.data(), proof, tree.GetRoot()));
+        proof.hashes.resize(proof.hashes.size() - (HASH_SIZE - 1));
+        EXPECT_FALSE(
+            coin::mt::VerifyMultiProof(proven.data(), proof, tree.GetRoot()));
+      }
+    }
+  }
+  coin::mt::FlatTree tree;
+  tree.Build(leaves.data(), 10);
+  coin::mt::MultiProof proof;
+  EXPECT_FALSE(coin::mt::MakeMultiProof(tree, {3, 10}, proof));
+}
+
+TEST(RootAccumulator, MatchesFullBuild) {
+  const size_t HASH_SIZE = coin::mt::HASH_SIZE;
+  std::vector<uint8_t> leaves = MakeRandomData(100 * HASH_SIZE);
+  coin::mt::RootAccumulator accumulator;
+  EXPECT_TRUE(accumulator.Root().value.empty());
+  for (size_t n = 1; n <= 100; ++n) {
+    accumulator.Push(leaves.data() + (n - 1) * HASH_SIZE);
+    coin::mt::FlatTree tree;
+    tree.Build(leaves.data(), n);
+    ASSERT_EQ(accumulator.Root().value, tree.Root().value) << n;
+  }
+  EXPECT_EQ(accumulator.size(), 100);
+
+  std::stringstream ss(std::string(g_random_data.begin(), g_random_data.end()));
+  EXPECT_EQ(coin::mt::HashStreamChunks(ss, g_bytes_each_trunk).value,
+            g_proot->get_hash().value);
+}
+
+TEST(MerkleDiff, LocalAndRemote) {
+  const size_t HASH_SIZE = coin::mt::HASH_SIZE;
+  const size_t n = 10000;
+  std::vector<uint8_t> leaves = MakeRandomData(n * HASH_SIZE);
+  coin::mt::FlatTree a;
+  a.Build(leaves.data(), n);
+  std::vector<uint64_t> changed = {0, 17, 18, 4096, n - 1};
+  for (uint64_t index : changed) leaves[index * HASH_SIZE + 5] ^= 0xff;
+  coin::mt::FlatTree b;
+  b.Build(leaves.data(), n);
+
+  std::vector<uint64_t> diff;
+  EXPECT_TRUE(coin::mt::DiffTrees(a, b, diff));
+  EXPECT_EQ(diff, changed);
+  EXPECT_TRUE(coin::mt::DiffTrees(a, a, diff));
+  EXPECT_TRUE(diff.empty());
+  coin::mt::FlatTree smaller;
+  smaller.Build(leaves.data(), n - 1);
+  EXPECT_FALSE(coin::mt::DiffTrees(a, smaller, diff));
+
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  bool served = false;
+  std::thread server([&served, &a, &fds]() {
+    coin::FdStream s(fds[1]);
+    served = coin::mt::ServeDiff(s, a);
+  });
+  coin::FdStream s(fds[0]);
+  EXPECT_TRUE(coin::mt::DiffRemote(s, b, diff));
+  server.join();
+  close(fds[0]);
+  close(fds[1]);
+  EXPECT_TRUE(served);
+  EXPECT_EQ(diff, changed);
+  // A few hash values per level and change, far less than the leaves.
+  EXPECT_LT(s.get_bytes_read(),
+            changed.size() * 2 * HASH_SIZE * b.level_count() + 64);
+
+  // A peer closing early fails the stream instead of raising SIGPIPE.
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  close(fds[1]);
+  coin::FdStream closed(fds[0]);
+  EXPECT_FALSE(coin::mt::ServeDiff(closed, a));
+  EXPECT_FALSE(closed.good());
+  close(fds[0]);
+
+  // Descriptors other than sockets are written with write().
+  ASSERT_EQ(pipe(fds), 0);
+  coin::FdStream pipe_out(fds[1]);
+  coin::FdStream pipe_in(fds[0]);
+  coin::data::MakeValue(uint32_t(0x01020304)).WriteToStream(pipe_out);
+  coin::data::MakeValue(uint32_t(0x05060708)).WriteToStream(pipe_out);
+  EXPECT_EQ(pipe_out.get_bytes_written(), 0);
+  EXPECT_TRUE(pipe_out.Flush());
+  EXPECT_EQ(pipe_out.get_bytes_written(), 8);
+  EXPECT_EQ(coin::data::ReadValue<uint32_t>(pipe_in), 0x01020304);
+  EXPECT_EQ(coin::data::ReadValue<uint32_t>(pipe_in), 0x05060708);
+  EXPECT_EQ(pipe_in.get_bytes_read(), 8);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST(SparseTree, UpdatesAndProofs) {
+  const size_t HASH_SIZE = coin::mt::HASH_SIZE;
+  // MakeRandomData() reseeds on each call, slice one block instead.
+  std::vector<uint8_t> random = MakeRandomData(201 * HASH_SIZE);
+  std::vector<coin::mt::SparseTree::Update> updates;
+  for (int i = 0; i < 100; ++i) {
+    coin::data::Buffer value;
+    const uint8_t *p = random.data() + (100 + i) * HASH_SIZE;
+    value.value.assign(p, p + HASH_SIZE);
+    updates.emplace_back(coin::bn::HashNum(random.data() + i * HASH_SIZE),
+                         value);
+  }
+  coin::mt::SparseTree empty;
+  coin::mt::SparseTree batch;
+  batch.Apply(updates);
+  EXPECT_EQ(batch.size(), 100);
+  coin::mt::SparseTree single;
+  for (auto it = updates.rbegin(); it != updates.rend(); ++it) {
+    single.Set(it->first, it->second.value.data());
+  }
+  EXPECT_EQ(single.Root().value, batch.Root().value);
+  EXPECT_NE(batch.Root().value, empty.Root().value);
+
+  coin::mt::SparseProof proof;
+  uint8_t value[HASH_SIZE];
+  for (const auto &update : updates) {
+    ASSERT_TRUE(batch.Get(update.first, value));
+    batch.MakeProof(update.first, proof);
+    EXPECT_TRUE(coin::mt::VerifySparseProof(update.first, value, proof,
+                                            batch.GetRoot()));
+    EXPECT_FALSE(coin::mt::VerifySparseProof(update.first, nullptr, proof,
+                                             batch.GetRoot()));
+  }
+
+  // Non-membership.
+  coin::bn::HashNum absent(random.data() + 200 * HASH_SIZE);
+  EXPECT_FALSE(batch.Get(absent, value));
+  batch.MakeProof(absent, proof);
+  EXPECT_TRUE(
+      coin::mt::VerifySparseProof(absent, nullptr, proof, batch.GetRoot()));
+  EXPECT_FALSE(
+      coin::mt::VerifySparseProof(absent, value, proof, batch.GetRoot()));
+  std::stringstream ss;
+  proof.Serialize(ss);
+  EXPECT_EQ(ss.str().size(), proof.GetSerializedSize());
+  coin::mt::SparseProof read_proof;
+  read_proof.Unserialize(ss);
+  EXPECT_TRUE(coin::mt::VerifySparseProof(absent, nullptr, read_proof,
+                                          batch.GetRoot()));
+
+  // Removing keys leaves the same tree as never adding them.
+  coin::mt::SparseTree half;
+  half.Apply(std::vector<coin::mt::SparseTree::Update>(updates.begin(),
+                                                       updates.begin() + 50));
+  coin::mt::SparseTree removed = batch;
+  for (size_t i = 50; i < updates.size(); ++i) removed.Remove(updates[i].first);
+  EXPECT_EQ(removed.Root().value, half.Root().value);
+  EXPECT_EQ(removed.node_count(), half.node_count());
+  EXPECT_LT(half.node_count(), 50 * 4);
+
+  // A single key is folded with default hash values only.
+  coin::mt::SparseTree one;
+  one.Set(updates[0].first, updates[0].second.value.data());
+  one.MakeProof(updates[0].first, proof);
+  EXPECT_EQ(proof.num_siblings(), 0);
+  EXPECT_TRUE(coin::mt::VerifySparseProof(
+      updates[0].first, updates[0].second.value.data(), proof, one.GetRoot()));
+
+  // Update one value, then remove every key.
+  updates[0].second.value[0] ^= 1;
+  auto root = batch.Root();
+  batch.Apply({updates[0]});
+  EXPECT_NE(batch.Root().value, root.value);
+  for (auto &update : updates) update.second.value.clear();
+  batch.Apply(updates);
+  EXPECT_EQ(batch.size(), 0);
+  EXPECT_EQ(batch.node_count(), 0);
+  EXPECT_EQ(batch.Root().value, empty.Root().value);
+}
+
+TEST(DiskTree, BuildProveAndUpdate) {
+  const size_t HASH_SIZE = coin::mt::HASH_SIZE;
+  const size_t n = 1000;
+  std::vector<uint8_t> leaves = MakeRandomData(n * HASH_SIZE);
+  coin::mt::FlatTree flat;
+  flat.Build(leaves.data(), n);
+
+  char path[] = "/tmp/cryptocoin_tree_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  coin::mt::DiskTree tree;
+  EXPECT_EQ(tree.level_count(), 0);
+  EXPECT_TRUE(tree.Root().value.empty());
+  ASSERT_TRUE(tree.Create(path, leaves.data(), n));
+  EXPECT_EQ(tree.Root().value, flat.Root().value);
+  EXPECT_EQ(tree.level_count(), flat.level_count());
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(tree.GetHash(1, 0)) % 4096, 0);
+
+  // Update, then reopen read-only and prove.
+  leaves[7 * HASH_SIZE] ^= 1;
+  EXPECT_TRUE(tree.Update(7, leaves.data() + 7 * HASH_SIZE));
+  EXPECT_FALSE(tree.Update(n, leaves.data()));
+  tree.Close();
+  flat.Build(leaves.data(), n);
+  ASSERT_TRUE(tree.Open(path));
+  EXPECT_EQ(tree.Root().value, flat.Root().value);
+  EXPECT_FALSE(tree.Update(7, leaves.data()));
+  coin::mt::Proof proof;
+  ASSERT_TRUE(coin::mt::MakeProof(tree, 7, proof));
+  EXPECT_TRUE(coin::mt::VerifyProof(leaves.data() + 7 * HASH_SIZE, proof,
+                                    flat.GetRoot()));
+  tree.Close();
+
+  // The node hash mode is kept in the file.
+  coin::mt::FlatTree flat64(coin::mt::NodeHashMode::Hash64);
+  flat64.Build(leaves.data(), n);
+  ASSERT_TRUE(tree.Create(path, leaves.data(), n,
+                          coin::mt::NodeHashMode::Hash64));
+  tree.Close();
+  ASSERT_TRUE(tree.Open(path));
+  EXPECT_EQ(tree.get_node_hash_mode(), coin::mt::NodeHashMode::Hash64);
+  EXPECT_EQ(tree.Root().value, flat64.Root().value);
+  tree.Close();
+
+  // A damaged header is rejected.
+  fd = open(path, O_WRONLY);
+  ASSERT_EQ(write(fd, "X", 1), 1);
+  close(fd);
+  EXPECT_FALSE(tree.Open(path));
+  EXPECT_EQ(tree.level_count(), 0);
+  EXPECT_TRUE(tree.Root().value.empty());
+  unlink(path);
+}
+
 TEST(BigNumber, Assign) {
   uint8_t n = 100, n2 = 101;
   coin::bn::BigNum<1> bn1(&n), bn2(&n2);
@@ -167,6 +1012,20 @@ TEST(BigNumber, InitWithString) {
   const uint8_t num_sz[] = {0x11, 0x22, 0x33, 0x44};
   auto num2 = coin::bn::BigNum<4>(num_sz);
   EXPECT_EQ(num, num2);
+
+  coin::bn::BigNum<4> num3(num_sz);
+  EXPECT_TRUE(coin::bn::BigNum<4>::FromString("aabbccdd", num3));
+  EXPECT_EQ(num3.ToString(), "aabbccdd");
+  EXPECT_FALSE(coin::bn::BigNum<4>::FromString("aabbcc", num3));
+  EXPECT_FALSE(coin::bn::BigNum<4>::FromString("aabbccddee", num3));
+  EXPECT_FALSE(coin::bn::BigNum<4>::FromString("aabbccdx", num3));
+  EXPECT_EQ(num3.ToString(), "aabbccdd");
+}
+
+TEST(BigNumber, ToString) {
+  std::string str =
+      "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f";
+  EXPECT_EQ(coin::bn::HashNum::FromString(str).ToString(), str);
 }
 
 TEST(BigNumber, Stream) {
@@ -215,7 +1074,585 @@ TEST(BigNumber, CompareBiggerThan) {
   EXPECT_TRUE(bn1 != bn2);
 }
 
+/// Transaction with `n` inputs and outputs.
+coin::Transaction MakeTestTransaction(int n) {
+  coin::Transaction tx;
+  for (int i = 0; i < n; ++i) {
+    coin::TxIn in;
+    in.tx_hash = coin::bn::HashNum(MakeRandomData(32).data());
+    in.out_index = i;
+    tx.add_tx_in(in);
+    coin::TxOut out;
+    out.address = "12iPmmNQQ9oqnjT5Nj7eg7bPmQtLXUQUmq";
+    out.amount = 1000 + i;
+    tx.add_tx_out(out);
+  }
+  return tx;
+}
+
+TEST(Transaction, HashCacheInvalidation) {
+  coin::Transaction tx = MakeTestTransaction(3);
+  auto hash = tx.CalcHash();
+  EXPECT_EQ(tx.CalcHash().value, hash.value);
+  EXPECT_EQ(tx.get_hash(), coin::bn::HashNum(hash.value.data()));
+
+  // A copy has the same cached value, then both change independently.
+  coin::Transaction copy = tx;
+  coin::TxOut out;
+  out.address = "12iPmmNQQ9oqnjT5Nj7eg7bPmQtLXUQUmq";
+  out.amount = 1;
+  tx.add_tx_out(out);
+  auto hash_out = tx.CalcHash();
+  EXPECT_NE(hash_out.value, hash.value);
+  EXPECT_EQ(tx.get_hash(), coin::bn::HashNum(hash_out.value.data()));
+  EXPECT_EQ(copy.CalcHash().value, hash.value);
+
+  copy.add_tx_out(out);
+  EXPECT_EQ(copy.CalcHash().value, hash_out.value);
+  coin::TxIn in;
+  in.tx_hash = coin::bn::HashNum(hash.value.data());
+  in.out_index = 0;
+  copy.add_tx_in(in);
+  EXPECT_NE(copy.CalcHash().value, hash_out.value);
+
+  // Concurrent const calls agree on one cached value.
+  coin::Transaction shared = MakeTestTransaction(8);
+  coin::Transaction expected = shared;
+  const coin::data::Buffer &expected_hash = expected.CalcHash();
+  std::vector<const coin::data::Buffer *> results(4);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < results.size(); ++i) {
+    threads.emplace_back(
+        [&shared, &results, i]() { results[i] = &shared.CalcHash(); });
+  }
+  for (auto &thread : threads) thread.join();
+  for (auto result : results) {
+    EXPECT_EQ(result, results[0]);
+    EXPECT_EQ(result->value, expected_hash.value);
+  }
+}
+
 TEST(Block, CreateGenesisBlock) {
   auto block = coin::blk::BlockBuilder::BuildGenesisBlock();
   EXPECT_EQ(block.get_height(), 0);
 }
+
+TEST(Block, HashFromMidstate) {
+  auto block = coin::blk::BlockBuilder::BuildGenesisBlock();
+  block.set_prev_hash(
+      "00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff");
+  auto midstate = block.MakeMidstate();
+  for (uint32_t nonce = 0; nonce < 10; ++nonce) {
+    block.set_nonce(nonce);
+    EXPECT_EQ(block.CalcHash(midstate, nonce), block.CalcHash());
+  }
+  block.MakeHash();
+  EXPECT_EQ(block.get_block_hash(), block.CalcHash());
+}
+
+TEST(ByteStream, WriterAndReader) {
+  uint8_t buf[6];
+  coin::data::ByteWriter fixed(buf, sizeof(buf));
+  coin::data::MakeValue(uint32_t(0x01020304)).WriteToStream(fixed);
+  EXPECT_TRUE(fixed.good());
+  coin::data::MakeValue(uint32_t(5)).WriteToStream(fixed);
+  EXPECT_FALSE(fixed.good());
+  EXPECT_EQ(fixed.get_size(), 4);
+  EXPECT_EQ(buf[0], 1);
+
+  coin::data::ByteWriter writer;
+  coin::data::MakeValue(std::string(1000, 'a')).WriteToStream(writer);
+  EXPECT_TRUE(writer.good());
+  std::vector<uint8_t> data = writer.Release();
+  EXPECT_EQ(data.size(), 1004);
+  EXPECT_EQ(writer.get_size(), 0);
+
+  coin::data::ByteReader reader(data);
+  EXPECT_EQ(coin::data::ReadValue<std::string>(reader), std::string(1000, 'a'));
+  EXPECT_TRUE(reader.good());
+  EXPECT_TRUE(reader.eof());
+
+  // Truncated input reads as zero and sets the fail flag.
+  coin::data::ByteReader truncated(data.data(), 4 + 10);
+  EXPECT_EQ(truncated.Skip(4), data.data());
+  EXPECT_EQ(truncated.Skip(11), nullptr);
+  EXPECT_FALSE(truncated.good());
+  EXPECT_EQ(coin::data::ReadValue<uint32_t>(truncated), 0);
+}
+
+TEST(ByteStream, TransactionAndBlock) {
+  coin::Transaction tx = MakeTestTransaction(3);
+  coin::TxIn in;
+  in.tx_hash = coin::bn::HashNum(MakeRandomData(32).data());
+  in.out_index = 7;
+  in.signature.value = {1, 2, 3};
+  tx.add_tx_in(in);
+  std::stringstream ss;
+  tx.Serialize(ss);
+  coin::data::ByteWriter writer;
+  tx.Serialize(writer);
+  std::vector<uint8_t> data = writer.Release();
+  EXPECT_EQ(std::string(data.begin(), data.end()), ss.str());
+
+  coin::data::ByteReader reader(data);
+  coin::Transaction read_tx;
+  read_tx.Unserialize(reader);
+  EXPECT_TRUE(reader.eof());
+  EXPECT_EQ(read_tx.CalcHash().value, tx.CalcHash().value);
+
+  coin::blk::Block block;
+  block.set_height(10);
+  block.set_nonce(42);
+  block.set_prev_hash(in.tx_hash);
+  block.get_trans().push_back(tx);
+  block.get_trans().push_back(read_tx);
+  block.MakeHash();
+  block.Serialize(writer);
+  data = writer.Release();
+  coin::blk::Block read_block;
+  coin::data::ByteReader block_reader(data);
+  read_block.Unserialize(block_reader);
+  EXPECT_TRUE(block_reader.eof());
+  EXPECT_EQ(read_block.get_height(), 10);
+  EXPECT_EQ(read_block.get_prev_hash(), in.tx_hash);
+  EXPECT_EQ(read_block.get_block_hash(), block.get_block_hash());
+  ASSERT_EQ(read_block.get_trans().size(), 2);
+  EXPECT_EQ(read_block.get_trans()[1].CalcHash().value, tx.CalcHash().value);
+
+  // A truncated block fails instead of reading garbage.
+  coin::blk::Block short_block;
+  coin::data::ByteReader short_reader(data.data(), data.size() - 1);
+  short_block.Unserialize(short_reader);
+  EXPECT_FALSE(short_reader.good());
+}
+
+TEST(ByteStream, SerializedSize) {
+  coin::Transaction tx = MakeTestTransaction(5);
+  coin::TxIn in;
+  std::vector<uint8_t> signature = MakeRandomData(71);
+  in.signature.CopyFrom(signature.data(), signature.size());
+  tx.add_tx_in(in);
+  tx.set_pub_key(coin::data::Buffer(MakeRandomData(33)));
+  coin::data::SizeCounter counter;
+  tx.Serialize(counter);
+  EXPECT_EQ(tx.GetSerializedSize(), counter.get_size());
+
+  coin::blk::Block block = coin::blk::BlockBuilder::BuildGenesisBlock();
+  block.get_trans().push_back(tx);
+  block.get_trans().push_back(MakeTestTransaction(0));
+  coin::data::SizeCounter block_counter;
+  block.Serialize(block_counter);
+  size_t size = block.GetSerializedSize();
+  EXPECT_EQ(size, block_counter.get_size());
+
+  // An exact reservation is never exceeded.
+  std::vector<uint8_t> buf(size);
+  coin::data::ByteWriter writer(buf.data(), buf.size());
+  block.Serialize(writer);
+  EXPECT_TRUE(writer.good());
+  EXPECT_EQ(writer.get_size(), size);
+}
+
+TEST(ByteStream, VarInt) {
+  const uint64_t values[] = {0,          1,           127,       128,
+                             16383,      16384,       UINT32_MAX,
+                             UINT64_MAX - 1, UINT64_MAX};
+  coin::data::ByteWriter writer;
+  size_t size = 0;
+  for (uint64_t value : values) {
+    coin::data::WriteVarInt(writer, value);
+    size += coin::data::GetVarIntSize(value);
+  }
+  EXPECT_EQ(writer.get_size(), size);
+  EXPECT_EQ(coin::data::GetVarIntSize(127), 1);
+  EXPECT_EQ(coin::data::GetVarIntSize(128), 2);
+  EXPECT_EQ(coin::data::GetVarIntSize(UINT64_MAX), coin::data::MAX_VARINT_SIZE);
+  std::vector<uint8_t> data = writer.Release();
+  coin::data::ByteReader reader(data);
+  for (uint64_t value : values) {
+    EXPECT_EQ(coin::data::ReadVarInt(reader), value);
+  }
+  EXPECT_TRUE(reader.eof());
+
+  // Malformed forms fail the reader.
+  const std::vector<std::vector<uint8_t>> malformed = {
+      {0x80, 0x00},                  // Overlong zero.
+      {0xff, 0x00},                  // Overlong 127.
+      {0x80},                        // Truncated.
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x02},
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x81, 0x00}};
+  for (const auto &bytes : malformed) {
+    coin::data::ByteReader bad(bytes);
+    EXPECT_EQ(coin::data::ReadVarInt(bad), 0);
+    EXPECT_FALSE(bad.good());
+  }
+  coin::data::ByteWriter long_length;
+  coin::data::WriteVarInt(long_length, uint64_t(UINT32_MAX) + 1);
+  coin::data::ByteReader length_reader(long_length.get_data(),
+                                       long_length.get_size());
+  length_reader.set_format(coin::data::Format::Compact);
+  EXPECT_EQ(coin::data::ReadLength(length_reader), 0);
+  EXPECT_FALSE(length_reader.good());
+
+  // Integer fields out of range of their type fail in the Compact format.
+  const int64_t int_values[] = {int64_t(INT32_MAX) + 1, int64_t(INT32_MIN) - 1,
+                                INT32_MAX, INT32_MIN};
+  for (int64_t value : int_values) {
+    coin::data::ByteWriter int_writer;
+    int_writer.set_format(coin::data::Format::Compact);
+    coin::data::WriteInt(int_writer, value);
+    coin::data::ByteReader int_reader(int_writer.get_data(),
+                                      int_writer.get_size());
+    int_reader.set_format(coin::data::Format::Compact);
+    bool fits = value >= INT32_MIN && value <= INT32_MAX;
+    EXPECT_EQ(coin::data::ReadInt<int>(int_reader), fits ? value : 0);
+    EXPECT_EQ(int_reader.good(), fits) << value;
+  }
+  coin::data::ByteWriter uint_writer;
+  coin::data::WriteVarInt(uint_writer, (uint64_t(1) << 32) + 5);
+  coin::data::ByteReader uint_reader(uint_writer.get_data(),
+                                     uint_writer.get_size());
+  uint_reader.set_format(coin::data::Format::Compact);
+  EXPECT_EQ(coin::data::ReadInt<uint32_t>(uint_reader), 0);
+  EXPECT_FALSE(uint_reader.good());
+
+  const int64_t signed_values[] = {0, -1, 1, -64, 64, INT64_MIN, INT64_MAX};
+  for (int64_t value : signed_values) {
+    uint64_t encoded = coin::data::utils::ZigZagEncode(value);
+    EXPECT_EQ(coin::data::utils::ZigZagDecode(encoded), value);
+  }
+  EXPECT_EQ(coin::data::utils::ZigZagEncode(-1), 1);
+  EXPECT_EQ(coin::data::utils::ZigZagEncode(1), 2);
+}
+
+TEST(ByteStream, CompactFormat) {
+  coin::Transaction tx = MakeTestTransaction(4);
+  coin::TxIn in;
+  in.out_index = -3;
+  tx.add_tx_in(in);
+  coin::blk::Block block = coin::blk::BlockBuilder::BuildGenesisBlock();
+  block.get_trans().push_back(tx);
+  block.get_trans().push_back(tx);
+
+  coin::data::ByteWriter legacy;
+  block.Serialize(legacy);
+  coin::data::ByteWriter compact;
+  compact.set_format(coin::data::Format::Compact);
+  block.Serialize(compact);
+  EXPECT_EQ(compact.get_size(),
+            block.GetSerializedSize(coin::data::Format::Compact));
+  EXPECT_LT(compact.get_size(), legacy.get_size());
+
+  std::vector<uint8_t> data = compact.Release();
+  coin::data::ByteReader reader(data);
+  reader.set_format(coin::data::Format::Compact);
+  coin::blk::Block read_block;
+  read_block.Unserialize(reader);
+  EXPECT_TRUE(reader.eof());
+  ASSERT_EQ(read_block.get_trans().size(), block.get_trans().size());
+  EXPECT_EQ(read_block.get_trans().back().CalcHash().value,
+            tx.CalcHash().value);
+
+  // Migrate the legacy record and back.
+  std::vector<uint8_t> legacy_data = legacy.Release();
+  std::vector<uint8_t> converted;
+  ASSERT_TRUE(coin::data::ConvertFormat<coin::blk::Block>(
+      legacy_data.data(), legacy_data.size(), coin::data::Format::Legacy,
+      coin::data::Format::Compact, converted));
+  EXPECT_EQ(converted, data);
+  ASSERT_TRUE(coin::data::ConvertFormat<coin::blk::Block>(
+      data.data(), data.size(), coin::data::Format::Compact,
+      coin::data::Format::Legacy, converted));
+  EXPECT_EQ(converted, legacy_data);
+  EXPECT_FALSE(coin::data::ConvertFormat<coin::blk::Block>(
+      data.data(), data.size() - 1, coin::data::Format::Compact,
+      coin::data::Format::Legacy, converted));
+
+  // Tagged records are read in the format they were written.
+  coin::data::ByteWriter tagged;
+  tagged.set_format(coin::data::Format::Compact);
+  coin::data::WriteTaggedRecord(tagged, block);
+  EXPECT_EQ(tagged.get_size(), 1 + data.size());
+  std::vector<uint8_t> tagged_data = tagged.Release();
+  coin::data::Format format = coin::data::Format::Legacy;
+  ASSERT_TRUE(coin::data::ReadTaggedRecord(
+      tagged_data.data(), tagged_data.size(), read_block, &format));
+  EXPECT_EQ(format, coin::data::Format::Compact);
+  EXPECT_EQ(read_block.get_trans().back().CalcHash().value,
+            tx.CalcHash().value);
+  ASSERT_TRUE(coin::data::ConvertFormat<coin::blk::Block>(
+      tagged_data.data(), tagged_data.size(), coin::data::Format::Legacy,
+      converted));
+  ASSERT_EQ(converted.size(), 1 + legacy_data.size());
+  EXPECT_EQ(converted[0], static_cast<uint8_t>(coin::data::Format::Legacy));
+  EXPECT_TRUE(std::equal(legacy_data.begin(), legacy_data.end(),
+                         converted.begin() + 1));
+  ASSERT_TRUE(coin::data::ReadTaggedRecord(converted.data(),
+                                           converted.size(), read_block,
+                                           &format));
+  EXPECT_EQ(format, coin::data::Format::Legacy);
+  tagged_data[0] = 2;
+  EXPECT_FALSE(coin::data::ReadTaggedRecord(
+      tagged_data.data(), tagged_data.size(), read_block));
+}
+
+TEST(BlockView, MatchesBlock) {
+  coin::Transaction tx = MakeTestTransaction(3);
+  coin::TxIn in;
+  in.tx_hash = coin::bn::HashNum(MakeRandomData(32).data());
+  in.out_index = -2;
+  in.signature.value = {1, 2, 3};
+  tx.add_tx_in(in);
+  tx.set_pub_key(coin::data::Buffer(std::vector<uint8_t>(33, 2)));
+  coin::blk::Block block = coin::blk::BlockBuilder::BuildGenesisBlock();
+  block.set_nonce(77);
+  block.set_prev_hash(in.tx_hash);
+  block.get_trans().push_back(tx);
+  block.MakeHash();
+
+  for (auto format : {coin::data::Format::Legacy,
+                      coin::data::Format::Compact}) {
+    coin::data::ByteWriter writer;
+    writer.set_format(format);
+    block.Serialize(writer);
+    coin::blk::BlockView view;
+    ASSERT_TRUE(view.Parse(writer.get_data(), writer.get_size(), format));
+    EXPECT_EQ(view.get_bytes().size, writer.get_size());
+    EXPECT_EQ(view.get_height(), block.get_height());
+    EXPECT_EQ(view.get_timestamp(), block.get_timestamp());
+    EXPECT_EQ(view.get_nonce(), 77);
+    EXPECT_EQ(view.get_prev_hash(), in.tx_hash);
+    EXPECT_EQ(view.get_block_hash(), block.get_block_hash());
+    ASSERT_EQ(view.transaction_count(), 2);
+
+    coin::TransactionView tx_view;
+    ASSERT_TRUE(view.GetTransaction(1, tx_view));
+    EXPECT_EQ(tx_view.get_bytes().size, tx.GetSerializedSize(format));
+    EXPECT_EQ(tx_view.get_time(), tx.get_time());
+    EXPECT_EQ(tx_view.get_pub_key().ToVector(), std::vector<uint8_t>(33, 2));
+    EXPECT_EQ(tx_view.get_merkle_hash().ToVector(), tx.CalcHash().value);
+    ASSERT_EQ(tx_view.txin_count(), 4);
+    ASSERT_EQ(tx_view.txout_count(), 3);
+    EXPECT_EQ(tx_view.GetTxIn(3).get_tx_hash(), in.tx_hash);
+    EXPECT_EQ(tx_view.GetTxIn(3).get_out_index(), -2);
+    EXPECT_EQ(tx_view.GetTxIn(3).get_signature().ToVector(),
+              std::vector<uint8_t>(in.signature.value.begin(),
+                                   in.signature.value.end()));
+    EXPECT_EQ(tx_view.GetTxIn(1).get_out_index(), 1);
+    EXPECT_EQ(tx_view.GetTxOut(2).get_address().ToString(),
+              "12iPmmNQQ9oqnjT5Nj7eg7bPmQtLXUQUmq");
+    EXPECT_EQ(tx_view.GetTxOut(2).get_amount(), 1002);
+
+    coin::Transaction read_tx;
+    tx_view.ToTransaction(read_tx);
+    EXPECT_EQ(read_tx.CalcHash().value, tx.CalcHash().value);
+    coin::blk::Block read_block;
+    view.ToBlock(read_block);
+    EXPECT_EQ(read_block.get_trans().size(), 2);
+
+    // Truncated records are rejected.
+    EXPECT_FALSE(view.Parse(writer.get_data(), writer.get_size() - 1, format));
+    EXPECT_FALSE(tx_view.Parse(writer.get_data(), writer.get_size(), format));
+  }
+}
+
+TEST(Arena, AllocateAndReset) {
+  coin::data::Arena arena(1024);
+  void *p = arena.Allocate(10, 1);
+  uint64_t *q = static_cast<uint64_t *>(arena.Allocate(sizeof(uint64_t), 8));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(q) % 8, 0);
+  EXPECT_NE(p, q);
+  // Larger than a slab.
+  uint8_t *big = static_cast<uint8_t *>(arena.Allocate(5000));
+  memset(big, 1, 5000);
+  EXPECT_GE(arena.get_memory_size(), 6024);
+  arena.Reset();
+  EXPECT_EQ(arena.get_used_size(), 0);
+  EXPECT_LT(arena.get_memory_size(), 6024);
+
+  std::vector<int, coin::data::ArenaAllocator<int>> values(&arena);
+  for (int i = 0; i < 1000; ++i) values.push_back(i);
+  EXPECT_EQ(values[999], 999);
+  EXPECT_GE(arena.get_used_size(), 1000 * sizeof(int));
+}
+
+TEST(BlockView, IndexTransactionsInArena) {
+  coin::blk::Block block = coin::blk::BlockBuilder::BuildGenesisBlock();
+  for (int i = 0; i < 20; ++i) {
+    block.get_trans().push_back(MakeTestTransaction(i % 4));
+  }
+  coin::data::ByteWriter writer;
+  block.Serialize(writer);
+  coin::blk::BlockView view;
+  ASSERT_TRUE(view.Parse(writer.get_data(), writer.get_size()));
+
+  coin::data::Arena arena;
+  for (int round = 0; round < 2; ++round) {
+    {
+      // The views die before Reset() frees their memory.
+      auto views = view.IndexTransactions(&arena);
+      ASSERT_EQ(views.size(), block.get_trans().size());
+      for (size_t i = 0; i < views.size(); ++i) {
+        coin::Transaction tx;
+        views[i].ToTransaction(tx);
+        EXPECT_EQ(tx.CalcHash().value,
+                  block.get_trans()[i].CalcHash().value);
+        EXPECT_EQ(views[i].txin_count(), i == 0 ? 0 : (i - 1) % 4);
+      }
+    }
+    EXPECT_GT(arena.get_used_size(), 0);
+    EXPECT_EQ(arena.get_memory_size(), coin::data::Arena::DEFAULT_SLAB_SIZE);
+    arena.Reset();
+  }
+
+  // Unserialize reserves from a ByteReader, so no push_back regrows.
+  coin::data::ByteReader reader(writer.get_data(), writer.get_size());
+  coin::blk::Block read_block;
+  read_block.Unserialize(reader);
+  EXPECT_EQ(read_block.get_trans().capacity(), read_block.get_trans().size());
+}
+
+TEST(Block, UnserializeInArena) {
+  coin::blk::Block block = coin::blk::BlockBuilder::BuildGenesisBlock();
+  for (int i = 0; i < 20; ++i) {
+    block.get_trans().push_back(MakeTestTransaction(i % 4));
+  }
+  coin::data::ByteWriter writer;
+  block.Serialize(writer);
+  std::vector<uint8_t> data(writer.get_data(),
+                            writer.get_data() + writer.get_size());
+
+  coin::data::Arena arena;
+  coin::blk::Block copy;
+  for (int round = 0; round < 2; ++round) {
+    {
+      coin::blk::Block read_block(&arena);
+      coin::data::ByteReader reader(data);
+      read_block.Unserialize(reader);
+      EXPECT_TRUE(reader.eof());
+      ASSERT_EQ(read_block.get_trans().size(), block.get_trans().size());
+      for (size_t i = 0; i < block.get_trans().size(); ++i) {
+        EXPECT_EQ(read_block.get_trans()[i].CalcHash().value,
+                  block.get_trans()[i].CalcHash().value);
+      }
+      EXPECT_GT(arena.get_used_size(), 0);
+      copy = read_block;
+    }
+    EXPECT_EQ(arena.get_memory_size(), coin::data::Arena::DEFAULT_SLAB_SIZE);
+    arena.Reset();
+  }
+
+  // The copy lives on the heap and outlives the arena contents.
+  coin::data::ByteWriter copy_writer;
+  copy.Serialize(copy_writer);
+  EXPECT_EQ(std::vector<uint8_t>(copy_writer.get_data(),
+                                 copy_writer.get_data() +
+                                     copy_writer.get_size()),
+            data);
+}
+
+TEST(DataValue, Containers) {
+  std::vector<uint32_t> ints = {1, 0x01020304, UINT32_MAX};
+  coin::data::ByteWriter writer;
+  coin::data::MakeValue(ints).WriteToStream(writer);
+  ASSERT_EQ(writer.get_size(), 4 + 3 * 4);
+  EXPECT_EQ(writer.get_data()[8], 1);  // Big-endian elements.
+  EXPECT_EQ(writer.get_data()[11], 4);
+
+  std::vector<uint8_t> random = MakeRandomData(64);
+  std::vector<coin::bn::HashNum> hashes = {
+      coin::bn::HashNum(random.data()), coin::bn::HashNum(random.data() + 32)};
+  std::array<uint16_t, 3> shorts = {{7, 0x8000, 0xffff}};
+  std::vector<std::string> strings = {"a", "", "bcd"};
+  std::vector<std::vector<int>> nested = {{1, -2}, {}, {3}};
+  coin::data::MakeValue(hashes).WriteToStream(writer);
+  coin::data::MakeValue(shorts).WriteToStream(writer);
+  coin::data::MakeValue(strings).WriteToStream(writer);
+  coin::data::MakeValue(nested).WriteToStream(writer);
+  size_t size = coin::data::MakeValue(ints).GetSerializedSize() +
+                coin::data::MakeValue(hashes).GetSerializedSize() +
+                coin::data::MakeValue(shorts).GetSerializedSize() +
+                coin::data::MakeValue(strings).GetSerializedSize() +
+                coin::data::MakeValue(nested).GetSerializedSize();
+  EXPECT_EQ(writer.get_size(), size);
+  EXPECT_EQ(coin::data::MakeValue(hashes).GetSerializedSize(), 4 + 64);
+
+  coin::data::ByteReader reader(writer.get_data(), writer.get_size());
+  EXPECT_EQ(coin::data::ReadValue<std::vector<uint32_t>>(reader), ints);
+  EXPECT_EQ(coin::data::ReadValue<std::vector<coin::bn::HashNum>>(reader),
+            hashes);
+  auto read_shorts = coin::data::ReadValue<std::array<uint16_t, 3>>(reader);
+  EXPECT_EQ(read_shorts, shorts);
+  EXPECT_EQ(coin::data::ReadValue<std::vector<std::string>>(reader), strings);
+  EXPECT_EQ(coin::data::ReadValue<std::vector<std::vector<int>>>(reader),
+            nested);
+  EXPECT_TRUE(reader.eof());
+
+  // A huge claimed length stops at the end of the input.
+  coin::data::ByteReader short_reader(writer.get_data(), 4 + 8);
+  EXPECT_EQ(coin::data::ReadValue<std::vector<uint32_t>>(short_reader).size(),
+            3);
+  EXPECT_FALSE(short_reader.good());
+
+  // So does a huge string or signature length, before allocating it.
+  const uint8_t huge_length[] = {0xff, 0xff, 0xff, 0xf0, 'a', 'b'};
+  coin::data::ByteReader string_reader(huge_length, sizeof(huge_length));
+  EXPECT_TRUE(coin::data::ReadValue<std::string>(string_reader).empty());
+  EXPECT_FALSE(string_reader.good());
+  std::vector<uint8_t> truncated_in(sizeof(coin::bn::HashNum) + 4);
+  truncated_in.insert(truncated_in.end(), huge_length,
+                      huge_length + sizeof(huge_length));
+  coin::data::ByteReader in_reader(truncated_in);
+  coin::TxIn in;
+  in.Unserialize(in_reader);
+  EXPECT_TRUE(in.signature.value.empty());
+  EXPECT_FALSE(in_reader.good());
+
+  // 8-byte elements are big-endian too.
+  std::vector<int64_t> longs = {-1, 0x0102030405060708, INT64_MIN};
+  std::vector<time_t> times = {0, 1500000000};
+  coin::data::ByteWriter long_writer;
+  coin::data::MakeValue(longs).WriteToStream(long_writer);
+  coin::data::MakeValue(times).WriteToStream(long_writer);
+  ASSERT_EQ(long_writer.get_size(), 4 + 3 * 8 + 4 + 2 * 8);
+  EXPECT_EQ(long_writer.get_data()[12], 1);
+  EXPECT_EQ(long_writer.get_data()[19], 8);
+  EXPECT_EQ(long_writer.get_data()[20], 0x80);
+  coin::data::ByteReader long_reader(long_writer.get_data(),
+                                     long_writer.get_size());
+  EXPECT_EQ(coin::data::ReadValue<std::vector<int64_t>>(long_reader), longs);
+  EXPECT_EQ(coin::data::ReadValue<std::vector<time_t>>(long_reader), times);
+  EXPECT_TRUE(long_reader.eof());
+}
+
+TEST(DataValue, SerializableObjects) {
+  coin::blk::Block block = coin::blk::BlockBuilder::BuildGenesisBlock();
+  block.get_trans().push_back(MakeTestTransaction(2));
+  coin::data::ByteWriter direct;
+  block.Serialize(direct);
+  coin::data::ByteWriter writer;
+  coin::data::MakeValue(block).WriteToStream(writer);
+  EXPECT_EQ(std::vector<uint8_t>(writer.get_data(),
+                                 writer.get_data() + writer.get_size()),
+            std::vector<uint8_t>(direct.get_data(),
+                                 direct.get_data() + direct.get_size()));
+  EXPECT_EQ(coin::data::MakeValue(block).GetSerializedSize(),
+            writer.get_size());
+
+  std::vector<coin::TxOut> outs(2);
+  outs[0].address = "12iPmmNQQ9oqnjT5Nj7eg7bPmQtLXUQUmq";
+  outs[0].amount = 5;
+  outs[1].amount = 6;
+  coin::data::ByteWriter out_writer;
+  out_writer.set_format(coin::data::Format::Compact);
+  coin::data::MakeValue(outs).WriteToStream(out_writer);
+  EXPECT_EQ(out_writer.get_size(),
+            coin::data::MakeValue(outs).GetSerializedSize(
+                coin::data::Format::Compact));
+  coin::data::ByteReader reader(out_writer.get_data(), out_writer.get_size());
+  reader.set_format(coin::data::Format::Compact);
+  auto read_outs = coin::data::ReadValue<std::vector<coin::TxOut>>(reader);
+  ASSERT_EQ(read_outs.size(), 2);
+  EXPECT_EQ(read_outs[0].address, outs[0].address);
+  EXPECT_EQ(read_outs[1].amount, 6);
+}
@@ -0,0 +1,39 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include "file_merkle.h"
+#include "hex.h"
+#include "thread_pool.h"
+
+/**
+ * Print the merkle root of a file.
+ *
+ * Usage: merkle_hash <file> [chunk_size] [threads]
+ */
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <file> [chunk_size] [threads]\n", argv[0]);
+    return 1;
+  }
+  size_t chunk_size = coin::mt::DEFAULT_CHUNK_SIZE;
+  if (argc > 2) chunk_size = strtoull(argv[2], nullptr, 10);
+  size_t num_threads = argc > 3 ? strtoul(argv[3], nullptr, 10) : 0;
+  if (chunk_size == 0 || chunk_size > UINT32_MAX) {
+    fprintf(stderr, "Invalid chunk size\n");
+    return 1;
+  }
+
+  coin::ThreadPool pool(num_threads);
+  coin::mt::FileHashResult result;
+  if (!coin::mt::HashFile(argv[1], chunk_size, pool, result)) {
+    fprintf(stderr, "Cannot map file %s\n", argv[1]);
+    return 1;
+  }
+  printf("%s\n", coin::hex::Encode(result.root.value).c_str());
+  fprintf(stderr,
+          "%llu bytes, %zu chunks, %zu threads, %.3f s, %.2f GB/s\n",
+          static_cast<unsigned long long>(result.file_size),
+          result.num_chunks, pool.get_num_threads(), result.seconds,
+          result.GetGBPerSec());
+  return 0;
+}